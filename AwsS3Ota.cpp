@@ -8,10 +8,135 @@
  */
 
 #include "AwsS3Ota.h"
+#include <time.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/platform_util.h>
+#include <Preferences.h>
+#include <esp_idf_version.h>
 
-// Buffers for manifest parsing
-#define MAX_VERSION_LEN 32
-#define MAX_FIRMWARE_URL_LEN 512
+// Binary fleet manifest layout (all integers little-endian):
+//   header  : "AOTF" | u8 format | u8 reserved | u16 recordSize | u32 recordCount | u32 reserved
+//   records : sorted by key, recordSize bytes each
+//             char hwId[16] | char channel[8] | char version[16] | u32 urlOffset | u32 urlLength
+//             format 2 adds: u8 cipher (0 none, 1 aes-ctr, 2 aes-gcm) | u8 reserved[3]
+//                            | u8 iv[16] (GCM uses the first 12) | u8 tag[16]
+//   strings : URLs, addressed by absolute urlOffset
+// Format 2 is only written when an entry is encrypted, so older devices
+// reject the table instead of flashing ciphertext.
+#define FLEET_HEADER_SIZE 16
+#define FLEET_FORMAT_VERSION 2  // Newest format understood
+#define FLEET_HW_ID_LEN 16
+#define FLEET_CHANNEL_LEN 8
+#define FLEET_KEY_LEN (FLEET_HW_ID_LEN + FLEET_CHANNEL_LEN)
+#define FLEET_VERSION_LEN 16
+#define FLEET_RECORD_MIN_SIZE 48
+#define FLEET_RECORD_V2_SIZE 84
+#define FLEET_CIPHER_OFFSET 48
+#define FLEET_IV_OFFSET 52
+#define FLEET_TAG_OFFSET 68
+
+// Block list for incremental sync (integers little-endian):
+//   header : "AOTB" | u8 format | u8 hashLength | u16 reserved | u32 blockSize | u32 imageSize
+//   hashes : SHA-256 of each blockSize chunk of the new image (last one may be short)
+#define BLOCKS_HEADER_SIZE 16
+#define BLOCKS_FORMAT_VERSION 1
+#define BLOCKS_HASH_LEN 32
+#define BLOCKS_MIN_BLOCK_SIZE 512  // Keeps the changed-block bitmap small
+
+// Check schedule kept in RTC slow memory - survives deep sleep, not power loss
+#define WAKE_STATE_MAGIC 0x414F5457
+#define WAKE_RETRY_BASE_SEC 60
+#define MAX_ETAG_LEN 64
+
+// Largest JSON manifest body accepted
+#define MAX_MANIFEST_SIZE 16384
+
+struct WakeState {
+    uint32_t magic;
+    time_t lastCheck;
+    time_t nextCheck;
+    uint8_t failures;
+    char version[MAX_VERSION_LEN];  // Manifest version that etag belongs to
+    char etag[MAX_ETAG_LEN];
+};
+
+RTC_DATA_ATTR static WakeState s_wakeState;
+
+// NVS namespace shared by everything the library persists
+#define OTA_NVS_NAMESPACE "awsota"
+
+// Outcome reports kept in NVS until the next successful check uploads them
+#define REPORT_NVS_KEY "reports"
+#define MAX_REPORTS 8
+
+// Firmware decryption key slot
+#define KEY_NVS_KEY "fwkey"
+
+// Report batch (integers little-endian):
+//   header  : "AORP" | u8 format | u8 recordCount | u16 reserved | u8 mac[6] | u16 reserved
+//   records : u32 time | u32 durationMs | u32 bytes | u32 bytesPerSec | u8 result | u8 attempts
+//             | i16 error | u8 fromLength | from | u8 toLength | to
+#define REPORT_HEADER_SIZE 16
+#define REPORT_FORMAT_VERSION 1
+#define REPORT_RECORD_MAX_SIZE (22 + 2 * MAX_VERSION_LEN)
+#define REPORT_BATCH_MAX_SIZE (REPORT_HEADER_SIZE + MAX_REPORTS * REPORT_RECORD_MAX_SIZE)
+
+#define REPORT_UPDATED 0
+#define REPORT_MANIFEST_FAILED 1
+#define REPORT_FLASH_FAILED 2
+
+struct OutcomeRecord {
+    uint32_t time;         // Unix time, 0 if the clock was never set
+    uint32_t durationMs;   // Whole check
+    uint32_t bytes;
+    uint32_t bytesPerSec;  // Download throughput
+    uint8_t result;
+    uint8_t attempts;
+    int16_t error;
+    char fromVersion[MAX_VERSION_LEN];
+    char toVersion[MAX_VERSION_LEN];
+};
+
+struct OutcomeRing {
+    uint8_t count;
+    OutcomeRecord records[MAX_REPORTS];  // Oldest first
+};
+
+static uint32_t readLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t* writeLe32(uint8_t* p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+    return p + 4;
+}
+
+// Decode exactly length bytes of hex
+static bool parseHex(const char* hex, uint8_t* out, size_t length) {
+    if (!hex || strlen(hex) != length * 2) return false;
+    for (size_t i = 0; i < length * 2; i++) {
+        char c = hex[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else return false;
+        out[i / 2] = (i % 2) ? (out[i / 2] | nibble) : (nibble << 4);
+    }
+    return true;
+}
+
+static uint8_t* writeVersion(uint8_t* p, const char* version) {
+    size_t length = strnlen(version, MAX_VERSION_LEN - 1);
+    *p++ = length;
+    memcpy(p, version, length);
+    return p + length;
+}
 
 AwsOta::AwsOta() {
     // Constructor
@@ -32,6 +157,11 @@ void AwsOta::begin(const char* manifestUrl, const char* currentVersion, const ch
 }
 
 void AwsOta::checkOnBoot(int delaySeconds) {
+    if (!isCheckDue()) {
+        log("Boot-time OTA check skipped (next check in %u s)", secondsUntilNextCheck());
+        return;
+    }
+    
     log("Setting up boot-time OTA check (delay: %d seconds)", delaySeconds);
     
     // Create a struct to pass parameters to the task
@@ -66,11 +196,89 @@ void AwsOta::checkEvery(unsigned long intervalMs) {
     );
 }
 
+void AwsOta::checkOnPush(const char* brokerUri, const char* topic,
+                         unsigned long fallbackIntervalMs, unsigned long spreadMs) {
+    // The task is checked too - it outlives a failed MQTT client init
+    if (_mqttClient || _pushCheckTaskHandle) {
+        log("Push trigger already running");
+        return;
+    }
+    
+    memset(_pushTopic, 0, sizeof(_pushTopic));
+    strncpy(_pushTopic, topic, sizeof(_pushTopic) - 1);
+    _pushFallbackMs = fallbackIntervalMs;
+    _pushSpreadMs = spreadMs;
+    log("Setting up push-triggered OTA check (%s, topic %s, fallback every %lu ms)",
+        brokerUri, _pushTopic, fallbackIntervalMs);
+    
+    // Task first, so a message arriving right after connect has someone to wake
+    if (xTaskCreate(pushCheckTask, "OTA_Push", 8192, this, 1, &_pushCheckTaskHandle) != pdPASS) {
+        log("ERROR: Failed to create push check task");
+        return;
+    }
+    
+    // Persistent session: the broker keeps QoS 1 pushes while we are offline
+    esp_mqtt_client_config_t config = {};
+#if ESP_IDF_VERSION_MAJOR >= 5
+    config.broker.address.uri = brokerUri;
+    config.broker.verification.certificate = _awsRootCa;
+    config.credentials.authentication.certificate = _pushClientCert;
+    config.credentials.authentication.key = _pushClientKey;
+    config.session.disable_clean_session = true;
+#else
+    config.uri = brokerUri;
+    config.cert_pem = _awsRootCa;
+    config.client_cert_pem = _pushClientCert;
+    config.client_key_pem = _pushClientKey;
+    config.disable_clean_session = true;
+#endif
+    
+    _mqttClient = esp_mqtt_client_init(&config);
+    if (!_mqttClient) {
+        log("ERROR: Failed to create MQTT client, using fallback polling only");
+        return;
+    }
+    esp_mqtt_client_register_event(_mqttClient, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID, mqttEventHandler, this);
+    esp_mqtt_client_start(_mqttClient);
+}
+
 bool AwsOta::checkNow() {
     log("Manual OTA check triggered");
     return performOtaUpdate();
 }
 
+void AwsOta::setWakeCheckInterval(uint32_t intervalSeconds) {
+    _wakeCheckInterval = intervalSeconds;
+    
+    if (s_wakeState.magic != WAKE_STATE_MAGIC) {
+        memset(&s_wakeState, 0, sizeof(s_wakeState));
+        s_wakeState.magic = WAKE_STATE_MAGIC;
+        log("Wake schedule: no saved state, check is due");
+    }
+    log("Wake check interval set to: %u seconds", intervalSeconds);
+}
+
+bool AwsOta::isCheckDue() {
+    return secondsUntilNextCheck() == 0;
+}
+
+uint32_t AwsOta::secondsUntilNextCheck() {
+    if (_wakeCheckInterval == 0 || s_wakeState.magic != WAKE_STATE_MAGIC) {
+        return 0;
+    }
+    
+    time_t now = time(NULL);
+    // Clock went backwards (e.g. first SNTP sync) - don't trust the schedule
+    if (now < s_wakeState.lastCheck || now >= s_wakeState.nextCheck) {
+        return 0;
+    }
+    return (uint32_t)(s_wakeState.nextCheck - now);
+}
+
+OtaState_t AwsOta::getState() {
+    return _state;
+}
+
 // ========================================
 // CONFIGURATION METHODS
 // ========================================
@@ -94,6 +302,52 @@ void AwsOta::setHttpTimeout(int timeoutSeconds) {
     log("HTTP timeout set to: %d seconds", timeoutSeconds);
 }
 
+void AwsOta::setIncrementalSync(bool enabled) {
+    _incrementalSync = enabled;
+    log("Incremental sync: %s", enabled ? "enabled" : "disabled");
+}
+
+void AwsOta::setReportEndpoint(const char* url) {
+    memset(_reportUrl, 0, sizeof(_reportUrl));
+    strncpy(_reportUrl, url, sizeof(_reportUrl) - 1);
+    log("Outcome reports: %s", _reportUrl);
+}
+
+void AwsOta::setTransport(OtaTransport* transport) {
+    _transport = transport ? transport : &_defaultTransport;
+    log("Transport: %s", _transport->name());
+}
+
+void AwsOta::setPushClientCert(const char* clientCert, const char* clientKey) {
+    _pushClientCert = clientCert;
+    _pushClientKey = clientKey;
+}
+
+bool AwsOta::storeDecryptionKey(const uint8_t* key, size_t length) {
+    if (length != 16 && length != 32) {
+        log("ERROR: Decryption key must be 16 or 32 bytes");
+        return false;
+    }
+    
+    Preferences prefs;
+    if (!prefs.begin(OTA_NVS_NAMESPACE, false)) {
+        log("ERROR: Cannot open NVS key slot");
+        return false;
+    }
+    bool stored = prefs.putBytes(KEY_NVS_KEY, key, length) == length;
+    prefs.end();
+    log(stored ? "Decryption key stored (AES-%u)" : "ERROR: Failed to store decryption key", length * 8);
+    return stored;
+}
+
+void AwsOta::setFleetManifest(const char* hardwareId, const char* channel) {
+    memset(_fleetHardwareId, 0, sizeof(_fleetHardwareId));
+    memset(_fleetChannel, 0, sizeof(_fleetChannel));
+    strncpy(_fleetHardwareId, hardwareId, FLEET_HW_ID_LEN);
+    strncpy(_fleetChannel, channel, FLEET_CHANNEL_LEN);
+    log("Fleet manifest: hardware '%s', channel '%s'", _fleetHardwareId, _fleetChannel);
+}
+
 // ========================================
 // CALLBACK SETTERS
 // ========================================
@@ -108,14 +362,77 @@ void AwsOta::onNoUpdate(OtaEventCallback_t cb) { _cbOnNoUpdate = cb; }
 // CORE OTA LOGIC
 // ========================================
 
-bool AwsOta::performOtaUpdate() {
-    if (_isUpdating) {
-        log("OTA already in progress!");
-        return false;
+bool AwsOta::performOtaUpdate(bool* failed) {
+    // Never log with the lock held - Serial can block, and a task suspended
+    // while holding it would stall the check that is about to finish
+    std::unique_lock<std::mutex> lock(_stateMutex);
+    
+    if (failed) *failed = false;
+    
+    if (_state == OTA_STATE_PENDING_REBOOT) {
+        lock.unlock();
+        log("Update already installed, reboot pending");
+        return true;
+    }
+    
+    if (_state != OTA_STATE_IDLE) {
+        if (_checkOwner == xTaskGetCurrentTaskHandle()) {
+            lock.unlock();
+            log("OTA check already running in this task!");
+            return false;
+        }
+        
+        // Coalesce: wait for the in-flight check and share its result
+        uint32_t generation = _checkGeneration;
+        lock.unlock();
+        log("OTA check in progress, waiting for its result...");
+        lock.lock();
+        _checkDone.wait(lock, [&] { return _checkGeneration != generation; });
+        if (failed) *failed = _lastCheckFailed;
+        return _lastCheckResult;
+    }
+    
+    _state = OTA_STATE_CHECKING;
+    _checkOwner = xTaskGetCurrentTaskHandle();
+    lock.unlock();
+    
+    bool checkFailed = false;
+    bool result = runOtaUpdate(checkFailed);
+    finishCheck(result, checkFailed, OTA_STATE_IDLE);
+    if (failed) *failed = checkFailed;
+    return result;
+}
+
+void AwsOta::finishCheck(bool result, bool failed, OtaState_t nextState) {
+    std::unique_lock<std::mutex> lock(_stateMutex, std::defer_lock);
+    if (!_suspendedTasks.empty()) {
+        // Other tasks are suspended, and one of them may hold the state lock
+        // or the condition variable's internal lock - waking waiters could
+        // block us forever. Every waiter is suspended or an OTA task, and
+        // the restart follows shortly, so just publish the result.
+        if (lock.try_lock()) {
+            _lastCheckResult = result;
+            _lastCheckFailed = failed;
+            _checkGeneration++;
+            _checkOwner = NULL;
+        }
+        _state = nextState;
+        return;
     }
     
-    _isUpdating = true;
+    lock.lock();
+    _lastCheckResult = result;
+    _lastCheckFailed = failed;
+    _checkGeneration++;
+    _checkOwner = NULL;
+    _state = nextState;
+    _checkDone.notify_all();
+}
+
+bool AwsOta::runOtaUpdate(bool& failed) {
     bool success = false;
+    bool flashed = false;
+    failed = false;
     
     log("=== Starting OTA Update ===");
     log("Free heap: %d bytes", ESP.getFreeHeap());
@@ -124,7 +441,8 @@ bool AwsOta::performOtaUpdate() {
     if (WiFi.status() != WL_CONNECTED) {
         log("ERROR: WiFi not connected");
         if (_cbOnError) _cbOnError("WiFi not connected");
-        _isUpdating = false;
+        failed = true;
+        recordCheckResult(false);
         return false;
     }
     
@@ -138,93 +456,151 @@ bool AwsOta::performOtaUpdate() {
     // Notify start
     if (_cbOnStart) _cbOnStart();
     
+    memset(&_attempt, 0, sizeof(_attempt));
+    _attempt.startMs = millis();
+    _transport->configure(_awsRootCa, _httpTimeout * 1000);
+    
     // Fetch manifest
-    char remoteVersion[MAX_VERSION_LEN] = {0};
-    char downloadUrl[MAX_FIRMWARE_URL_LEN] = {0};
+    OtaManifest manifest;
     
-    if (!fetchManifest(remoteVersion, sizeof(remoteVersion), downloadUrl, sizeof(downloadUrl))) {
+    if (!fetchManifest(manifest)) {
         log("ERROR: Failed to fetch manifest");
         if (_cbOnError) _cbOnError("Manifest fetch failed");
+        failed = true;
+        recordCheckResult(false);
+        recordOutcome(REPORT_MANIFEST_FAILED, "");
         goto cleanup;
     }
     
     // Compare versions
     log("Current version: %s", _currentVersion);
-    log("Remote version: %s", remoteVersion);
+    log("Remote version: %s", manifest.version);
     
-    if (strcmp(remoteVersion, _currentVersion) == 0) {
+    if (strcmp(manifest.version, _currentVersion) == 0) {
         log("Firmware is already up-to-date");
         if (_cbOnNoUpdate) _cbOnNoUpdate();
+        recordCheckResult(true);
         goto cleanup;
     }
     
-    log("Update available! %s -> %s", _currentVersion, remoteVersion);
+    log("Update available! %s -> %s", _currentVersion, manifest.version);
+    
+    _state = OTA_STATE_DOWNLOADING;
+    _attempt.downloadMs = millis();
+    
+    // Only fetch the changed blocks if the manifest publishes a block list.
+    // Block hashes can't be matched against an encrypted stream.
+    if (_incrementalSync && manifest.blocksUrl[0] && manifest.cipher == OTA_CIPHER_NONE) {
+        flashed = downloadIncremental(manifest.url, manifest.blocksUrl);
+        if (!flashed) {
+            log("Incremental sync not possible, falling back to full download");
+        }
+    }
     
     // Download and flash
-    if (downloadAndFlash(downloadUrl)) {
+    if (!flashed) {
+        flashed = downloadAndFlash(manifest);
+    }
+    _attempt.downloadMs = millis() - _attempt.downloadMs;
+    
+    if (flashed) {
         log("=== OTA Update Successful! ===");
         if (_cbOnComplete) _cbOnComplete();
+        recordCheckResult(true);
+        recordOutcome(REPORT_UPDATED, manifest.version);
         success = true;
+        finishCheck(true, false, OTA_STATE_PENDING_REBOOT);  // Release waiters before rebooting (tasks may still be suspended)
         vTaskDelay(pdMS_TO_TICKS(2000));
         ESP.restart();  // Will not return
     } else {
         log("ERROR: Download/flash failed");
         if (_cbOnError) _cbOnError("Download or flash failed");
+        failed = true;
+        recordCheckResult(false);
+        recordOutcome(REPORT_FLASH_FAILED, manifest.version);
     }
     
 cleanup:
+    _transport->stop();
+    
     // Resume tasks if suspended
     if (_autoTaskSuspend) {
         log("Resuming tasks...");
         autoResumeTasks();
     }
     
-    _isUpdating = false;
     log("=== OTA Update Complete ===");
     return success;
 }
 
-bool AwsOta::fetchManifest(char* remoteVersion, size_t versionSize, char* downloadUrl, size_t urlSize) {
-    memset(remoteVersion, 0, versionSize);
-    memset(downloadUrl, 0, urlSize);
+bool AwsOta::fetchManifest(OtaManifest& manifest) {
+    memset(&manifest, 0, sizeof(manifest));
+    
+    if (_fleetHardwareId[0]) {
+        return fetchFleetManifest(manifest);
+    }
     
     log("Fetching manifest from: %s", _manifestUrl);
     
+    // Pending outcome reports ride on the manifest connection
+    uint8_t reports[REPORT_BATCH_MAX_SIZE];
+    size_t reportLength = loadReportBatch(reports, sizeof(reports));
+    
     for (int attempt = 1; attempt <= _maxRetries; attempt++) {
         if (attempt > 1) {
             log("Retry %d/%d", attempt, _maxRetries);
             vTaskDelay(pdMS_TO_TICKS(2000));
         }
+        _attempt.attempts = attempt;
         
-        WiFiClientSecure client;
-        client.setCACert(_awsRootCa);
-        client.setTimeout(_httpTimeout);  // Hard timeout
+        OtaHeader_t headers[3] = {{"Accept", "application/json"}, {"Cache-Control", "no-cache"}};
+        size_t headerCount = 2;
         
-        HTTPClient http;
-        http.begin(client, _manifestUrl);
-        http.setTimeout(_httpTimeout * 1000);  // Convert to milliseconds
-        http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-        http.setReuse(false);
-        http.addHeader("Accept", "application/json");
-        http.addHeader("Cache-Control", "no-cache");
-        http.addHeader("Connection", "close");
+        // Conditional GET: only worth it while the cached manifest matches what we run.
+        // Not with reports pending - the connection is kept for their upload.
+        bool conditional = _wakeCheckInterval > 0 && s_wakeState.etag[0] && reportLength == 0 &&
+                           strcmp(s_wakeState.version, _currentVersion) == 0;
+        if (conditional) {
+            headers[headerCount++] = {"If-None-Match", s_wakeState.etag};
+        }
         
         log("Sending HTTP GET request...");
-        int code = http.GET();
+        int code = _transport->request("GET", _manifestUrl, headers, headerCount, reportLength > 0);
+        
+        if (conditional && code == HTTP_CODE_NOT_MODIFIED) {
+            log("Manifest not modified (ETag %s)", s_wakeState.etag);
+            _transport->end();
+            snprintf(manifest.version, sizeof(manifest.version), "%s", _currentVersion);
+            return true;
+        }
         
         if (code != HTTP_CODE_OK) {
             log("HTTP error: %d", code);
-            http.end();
+            _attempt.error = code;
+            _transport->end();
             continue;
         }
         
-        String payload = http.getString();
-        log("Response: %d bytes", payload.length());
-        http.end();
+        std::vector<char> payload;
+        if (!readBody(payload)) {
+            log("ERROR: Manifest read failed");
+            _transport->stop();
+            continue;
+        }
+        char etag[MAX_ETAG_LEN];
+        strncpy(etag, _transport->etag(), sizeof(etag) - 1);  // Overwritten by the report upload
+        etag[sizeof(etag) - 1] = '\0';
+        log("Response: %d bytes", payload.size());
+        _transport->end();
+        
+        if (reportLength > 0 && uploadReports(reports, reportLength)) {
+            reportLength = 0;  // Delivered - not again on a retry
+        }
+        _transport->stop();
         
         // Parse JSON
         JsonDocument doc;
-        DeserializationError err = deserializeJson(doc, payload);
+        DeserializationError err = deserializeJson(doc, payload.data(), payload.size());
         
         if (err) {
             log("JSON parse error: %s", err.c_str());
@@ -240,15 +616,30 @@ bool AwsOta::fetchManifest(char* remoteVersion, size_t versionSize, char* downlo
             continue;
         }
         
-        if (strncmp(url, "https://", 8) != 0) {
-            log("Invalid URL: must be HTTPS");
+        if (!_transport->supports(url)) {
+            log("Invalid URL: not supported by the %s transport", _transport->name());
+            continue;
+        }
+        
+        strncpy(manifest.version, version, sizeof(manifest.version) - 1);
+        strncpy(manifest.url, url, sizeof(manifest.url) - 1);
+        
+        // Optional block-hash list for incremental sync
+        const char* blocks = doc["blocks"];
+        if (blocks && _transport->supports(blocks)) {
+            strncpy(manifest.blocksUrl, blocks, sizeof(manifest.blocksUrl) - 1);
+        }
+        
+        if (!parseEncryption(doc, manifest)) {
             continue;
         }
         
-        strncpy(remoteVersion, version, versionSize - 1);
-        strncpy(downloadUrl, url, urlSize - 1);
+        if (_wakeCheckInterval > 0) {
+            snprintf(s_wakeState.version, sizeof(s_wakeState.version), "%s", version);
+            snprintf(s_wakeState.etag, sizeof(s_wakeState.etag), "%s", etag);
+        }
         
-        log("Manifest OK - Version: %s", remoteVersion);
+        log("Manifest OK - Version: %s", manifest.version);
         return true;
     }
     
@@ -256,97 +647,360 @@ bool AwsOta::fetchManifest(char* remoteVersion, size_t versionSize, char* downlo
     return false;
 }
 
-bool AwsOta::downloadAndFlash(const char* downloadUrl) {
-    log("Downloading firmware from S3...");
+bool AwsOta::fetchFleetManifest(OtaManifest& manifest) {
+    log("Fetching fleet manifest from: %s", _manifestUrl);
+    
+    // Search key: NUL-padded hardware ID followed by NUL-padded channel
+    uint8_t key[FLEET_KEY_LEN] = {0};
+    memcpy(key, _fleetHardwareId, strlen(_fleetHardwareId));
+    memcpy(key + FLEET_HW_ID_LEN, _fleetChannel, strlen(_fleetChannel));
+    
+    // Pending outcome reports go out once the lookup has succeeded
+    uint8_t reports[REPORT_BATCH_MAX_SIZE];
+    size_t reportLength = loadReportBatch(reports, sizeof(reports));
+    
+    for (int attempt = 1; attempt <= _maxRetries; attempt++) {
+        if (attempt > 1) {
+            log("Retry %d/%d", attempt, _maxRetries);
+            vTaskDelay(pdMS_TO_TICKS(2000));
+        }
+        _attempt.attempts = attempt;
+        
+        uint8_t header[FLEET_HEADER_SIZE];
+        uint8_t record[FLEET_RECORD_V2_SIZE];
+        
+        int code = requestRange(_manifestUrl, 0, FLEET_HEADER_SIZE);
+        if (code != HTTP_CODE_OK && code != HTTP_CODE_PARTIAL_CONTENT) {
+            log("HTTP error: %d", code);
+            _transport->end();
+            continue;
+        }
+        bool rangeSupported = (code == HTTP_CODE_PARTIAL_CONTENT);
+        
+        if (!readExact(header, sizeof(header))) {
+            log("ERROR: Truncated fleet manifest header");
+            _transport->stop();
+            continue;
+        }
+        
+        uint8_t format = header[4];
+        uint16_t recordSize = header[6] | (header[7] << 8);
+        uint32_t recordCount = readLe32(header + 8);
+        // Bytes of each record we use; the rest is skipped
+        uint16_t readSize = format >= 2 ? FLEET_RECORD_V2_SIZE : FLEET_RECORD_MIN_SIZE;
+        
+        if (memcmp(header, "AOTF", 4) != 0 || format < 1 || format > FLEET_FORMAT_VERSION ||
+            recordSize < readSize) {
+            log("Invalid fleet manifest header");
+            _transport->stop();
+            continue;
+        }
+        
+        log("Fleet manifest: %u entries (%s)", recordCount, rangeSupported ? "range lookup" : "streaming scan");
+        
+        bool found = false;
+        bool ioError = false;
+        uint32_t consumed = FLEET_HEADER_SIZE;  // Stream position in the non-Range case
+        
+        if (rangeSupported) {
+            _transport->end();
+            
+            // Binary search - one small Range request per probe
+            uint32_t lo = 0, hi = recordCount;
+            while (lo < hi) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                uint32_t offset = FLEET_HEADER_SIZE + mid * recordSize;
+                
+                if (requestRange(_manifestUrl, offset, readSize) != HTTP_CODE_PARTIAL_CONTENT ||
+                    !readExact(record, readSize)) {
+                    ioError = true;
+                    break;
+                }
+                _transport->end();
+                
+                int cmp = memcmp(record, key, FLEET_KEY_LEN);
+                if (cmp == 0) {
+                    found = true;
+                    break;
+                }
+                if (cmp < 0) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+        } else {
+            // No Range support - scan records in order, stop once past our key
+            for (uint32_t i = 0; i < recordCount; i++) {
+                if (!readExact(record, readSize)) {
+                    ioError = true;
+                    break;
+                }
+                consumed += readSize;
+                
+                int cmp = memcmp(record, key, FLEET_KEY_LEN);
+                if (cmp == 0) {
+                    found = true;
+                    break;
+                }
+                if (cmp > 0) {
+                    break;  // Sorted - our entry is not in the table
+                }
+                if (!skipExact(recordSize - readSize)) {
+                    ioError = true;
+                    break;
+                }
+                consumed += recordSize - readSize;
+            }
+        }
+        
+        if (ioError) {
+            log("ERROR: Fleet manifest read failed");
+            _transport->stop();
+            continue;
+        }
+        
+        if (!found) {
+            log("No fleet entry for hardware '%s', channel '%s'", _fleetHardwareId, _fleetChannel);
+            _transport->stop();
+            return false;
+        }
+        
+        uint32_t urlOffset = readLe32(record + FLEET_KEY_LEN + FLEET_VERSION_LEN);
+        uint32_t urlLength = readLe32(record + FLEET_KEY_LEN + FLEET_VERSION_LEN + 4);
+        
+        if (urlLength == 0 || urlLength >= sizeof(manifest.url)) {
+            log("Invalid fleet entry: bad url length %u", urlLength);
+            _transport->stop();
+            continue;
+        }
+        
+        uint8_t cipher = format >= 2 ? record[FLEET_CIPHER_OFFSET] : 0;
+        if (cipher == 1) {
+            manifest.cipher = OTA_CIPHER_AES_CTR;
+            manifest.ivLength = OTA_AES_BLOCK_SIZE;
+        } else if (cipher == 2) {
+            manifest.cipher = OTA_CIPHER_AES_GCM;
+            manifest.ivLength = 12;
+            memcpy(manifest.tag, record + FLEET_TAG_OFFSET, OTA_GCM_TAG_SIZE);
+        } else if (cipher != 0) {
+            log("Invalid fleet entry: unknown cipher %u", cipher);
+            _transport->stop();
+            return false;  // Flashing it as plaintext would brick the update
+        }
+        memcpy(manifest.iv, record + FLEET_IV_OFFSET, manifest.ivLength);
+        
+        bool urlOk;
+        if (rangeSupported) {
+            urlOk = requestRange(_manifestUrl, urlOffset, urlLength) == HTTP_CODE_PARTIAL_CONTENT &&
+                    readExact((uint8_t*)manifest.url, urlLength);
+        } else {
+            // Keep streaming forward to the string table, then stop
+            urlOk = urlOffset >= consumed &&
+                    skipExact(urlOffset - consumed) &&
+                    readExact((uint8_t*)manifest.url, urlLength);
+        }
+        // A Range response was read to the end, so its connection can carry the
+        // report upload. A partly read stream cannot.
+        if (urlOk && rangeSupported) {
+            _transport->end();
+        } else {
+            _transport->stop();
+        }
+        
+        if (!urlOk) {
+            log("ERROR: Failed to read firmware URL from fleet manifest");
+            memset(manifest.url, 0, sizeof(manifest.url));
+            continue;
+        }
+        manifest.url[urlLength] = '\0';
+        
+        if (!_transport->supports(manifest.url)) {
+            log("Invalid URL: not supported by the %s transport", _transport->name());
+            _transport->stop();
+            memset(manifest.url, 0, sizeof(manifest.url));
+            continue;
+        }
+        
+        if (reportLength > 0 && uploadReports(reports, reportLength)) {
+            reportLength = 0;
+        }
+        _transport->stop();
+        
+        memcpy(manifest.version, record + FLEET_KEY_LEN, min(sizeof(manifest.version) - 1, (size_t)FLEET_VERSION_LEN));
+        
+        log("Fleet manifest OK - Version: %s%s", manifest.version,
+            manifest.cipher != OTA_CIPHER_NONE ? " (encrypted)" : "");
+        return true;
+    }
     
-    WiFiClientSecure* client = new WiFiClientSecure;
-    if (!client) {
-        log("ERROR: Failed to create HTTPS client");
+    log("Fleet manifest fetch failed after %d attempts", _maxRetries);
+    return false;
+}
+
+int AwsOta::requestRange(const char* url, uint32_t offset, uint32_t length) {
+    char range[48];
+    snprintf(range, sizeof(range), "bytes=%u-%u", offset, offset + length - 1);
+    
+    OtaHeader_t headers[] = {{"Range", range}, {"Cache-Control", "no-cache"}};
+    return _transport->request("GET", url, headers, 2, true);  // Keep the connection for the next range
+}
+
+bool AwsOta::readExact(uint8_t* buffer, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        int n = _transport->read(buffer + done, length - done);
+        if (n <= 0) return false;  // Timeout, connection closed or body too short
+        done += n;
+    }
+    return true;
+}
+
+bool AwsOta::skipExact(size_t length) {
+    uint8_t discard[64];
+    while (length > 0) {
+        size_t n = min(length, sizeof(discard));
+        if (!readExact(discard, n)) return false;
+        length -= n;
+    }
+    return true;
+}
+
+bool AwsOta::readBody(std::vector<char>& body) {
+    uint8_t buff[256];
+    for (;;) {
+        int n = _transport->read(buff, sizeof(buff));
+        if (n == 0) return true;
+        if (n < 0 || body.size() + n > MAX_MANIFEST_SIZE) return false;
+        body.insert(body.end(), buff, buff + n);
+    }
+}
+
+bool AwsOta::parseEncryption(JsonDocument& doc, OtaManifest& manifest) {
+    const char* enc = doc["enc"];
+    if (!enc) return true;  // Plain image
+    
+    const char* iv = doc["iv"];
+    const char* tag = doc["tag"];
+    
+    if (strcmp(enc, "aes-ctr") == 0 && parseHex(iv, manifest.iv, OTA_AES_BLOCK_SIZE)) {
+        manifest.cipher = OTA_CIPHER_AES_CTR;
+        manifest.ivLength = OTA_AES_BLOCK_SIZE;
+    } else if (strcmp(enc, "aes-gcm") == 0 && parseHex(iv, manifest.iv, 12) &&
+               parseHex(tag, manifest.tag, OTA_GCM_TAG_SIZE)) {
+        manifest.cipher = OTA_CIPHER_AES_GCM;
+        manifest.ivLength = 12;
+    } else {
+        log("Invalid manifest: bad enc/iv/tag for encrypted image");
+        return false;
+    }
+    return true;
+}
+
+bool AwsOta::beginDecrypt(OtaDecrypt& decrypt, const OtaManifest& manifest) {
+    uint8_t key[32];
+    size_t keyLength = 0;
+    
+    Preferences prefs;
+    if (prefs.begin(OTA_NVS_NAMESPACE, true)) {
+        keyLength = prefs.getBytesLength(KEY_NVS_KEY);
+        if (keyLength > sizeof(key) || prefs.getBytes(KEY_NVS_KEY, key, keyLength) != keyLength) {
+            keyLength = 0;
+        }
+        prefs.end();
+    }
+    if (keyLength == 0) {
+        log("ERROR: Image is encrypted but no decryption key is provisioned");
         return false;
     }
     
-    client->setCACert(_awsRootCa);
-    client->setTimeout(_httpTimeout);  // Hard timeout
+    bool ok = decrypt.begin(manifest.cipher, key, keyLength, manifest.iv, manifest.ivLength);
+    mbedtls_platform_zeroize(key, sizeof(key));
+    if (!ok) {
+        log("ERROR: Decryption setup failed");
+        return false;
+    }
+    log("Decrypting %s image (AES-%u)", manifest.cipher == OTA_CIPHER_AES_GCM ? "GCM" : "CTR", keyLength * 8);
+    return true;
+}
+
+bool AwsOta::downloadAndFlash(const OtaManifest& manifest) {
+    const char* downloadUrl = manifest.url;
+    log("Downloading firmware from S3...");
     
-    HTTPClient http;
-    http.begin(*client, downloadUrl);
-    http.setTimeout(_httpTimeout * 1000);  // Convert to milliseconds
+    OtaDecrypt decrypt;
+    bool encrypted = manifest.cipher != OTA_CIPHER_NONE;
+    if (encrypted && !beginDecrypt(decrypt, manifest)) {
+        return false;
+    }
     
-    int code = http.GET();
+    int code = _transport->request("GET", downloadUrl, NULL, 0, false);
     if (code != HTTP_CODE_OK) {
         log("HTTP error: %d", code);
-        http.end();
-        delete client;
+        _attempt.error = code;
+        _transport->end();
         return false;
     }
     
-    int contentLength = http.getSize();
+    int contentLength = _transport->contentLength();
     log("Firmware size: %d KB", contentLength / 1024);
     
     if (contentLength <= 0) {
         log("ERROR: Invalid content length");
-        http.end();
-        delete client;
+        _transport->stop();
         return false;
     }
     
     // Begin update
     if (!Update.begin(contentLength)) {
         log("ERROR: Update.begin() failed: %d", Update.getError());
-        http.end();
-        delete client;
+        _attempt.error = Update.getError();
+        _transport->stop();
         return false;
     }
     
     // Download and write
-    WiFiClient* stream = http.getStreamPtr();
     size_t written = 0;
     uint8_t buff[512];
     int lastProgress = -1;
     
-    log("Downloading and flashing...");
+    log("Downloading and flashing via %s...", _transport->name());
     
-    unsigned long startTime = millis();
-    unsigned long timeoutMs = _httpTimeout * 1000;
+    unsigned long decryptUs = 0;
     
-    while (http.connected() && written < contentLength) {
-        // Hard timeout check
-        if (millis() - startTime > timeoutMs) {
-            log("ERROR: Hard timeout reached!");
-            Update.abort();
-            http.end();
-            delete client;
-            return false;
-        }
+    while (written < contentLength) {
+        // Full buffers (whole AES blocks) until the last one
+        size_t chunk = min(sizeof(buff), (size_t)(contentLength - written));
         
-        size_t available = stream->available();
-        if (available) {
-            int bytesRead = stream->readBytes(buff, min(available, sizeof(buff)));
-            if (bytesRead > 0) {
-                if (Update.write(buff, bytesRead) != bytesRead) {
-                    log("ERROR: Update.write() failed");
-                    Update.abort();
-                    http.end();
-                    delete client;
-                    return false;
-                }
-                written += bytesRead;
-                
-                // Progress callback
-                int progress = (written * 100) / contentLength;
-                if (progress != lastProgress && progress % 10 == 0) {
-                    log("Progress: %d%%", progress);
-                    if (_cbOnProgress) _cbOnProgress(progress);
-                    lastProgress = progress;
-                }
+        // Each read waits at most the HTTP timeout
+        if (!readExact(buff, chunk)) {
+            log("ERROR: Download stalled or connection lost");
+            break;
+        }
+        if (encrypted) {
+            unsigned long t0 = micros();
+            bool decrypted = decrypt.update(buff, chunk);  // In place
+            decryptUs += micros() - t0;
+            if (!decrypted) {
+                log("ERROR: Decryption failed");
+                Update.abort();
+                _transport->stop();
+                return false;
             }
-            startTime = millis();  // Reset timeout on activity
         }
+        if (Update.write(buff, chunk) != chunk) {
+            log("ERROR: Update.write() failed");
+            Update.abort();
+            _transport->stop();
+            return false;
+        }
+        written += chunk;
+        reportProgress(written, contentLength, lastProgress);
         vTaskDelay(pdMS_TO_TICKS(1));  // Yield
     }
     
-    http.end();
-    delete client;
+    _transport->stop();
+    _attempt.bytes += written;
     
     // Verify
     if (written != contentLength) {
@@ -355,9 +1009,22 @@ bool AwsOta::downloadAndFlash(const char* downloadUrl) {
         return false;
     }
     
+    _state = OTA_STATE_VERIFYING;
+    if (encrypted) {
+        log("Decrypted %d KB in %lu ms (%lu ms per MB)", written / 1024, decryptUs / 1000,
+            (unsigned long)((uint64_t)decryptUs * 1048576 / written / 1000));
+        // Must happen before Update.end() marks the image bootable
+        if (!decrypt.finish(manifest.tag, sizeof(manifest.tag))) {
+            log("ERROR: Image authentication failed (GCM tag mismatch)");
+            Update.abort();
+            return false;
+        }
+    }
+    
     // Finalize
     if (!Update.end(true)) {
         log("ERROR: Update.end() failed: %d", Update.getError());
+        _attempt.error = Update.getError();
         return false;
     }
     
@@ -365,6 +1032,308 @@ bool AwsOta::downloadAndFlash(const char* downloadUrl) {
     return true;
 }
 
+void AwsOta::recordCheckResult(bool success) {
+    if (_wakeCheckInterval == 0) return;
+    
+    time_t now = time(NULL);
+    uint32_t wait = _wakeCheckInterval;
+    
+    if (success) {
+        s_wakeState.failures = 0;
+    } else {
+        if (s_wakeState.failures < 31) s_wakeState.failures++;
+        // 1 min, 2 min, 4 min, ... never longer than the normal interval
+        uint32_t backoff = WAKE_RETRY_BASE_SEC << min((int)s_wakeState.failures - 1, 16);
+        wait = min(backoff, _wakeCheckInterval);
+    }
+    
+    s_wakeState.lastCheck = now;
+    s_wakeState.nextCheck = now + wait;
+    log("Next OTA check due in %u seconds", wait);
+}
+
+void AwsOta::recordOutcome(uint8_t result, const char* targetVersion) {
+    if (!_reportUrl[0]) return;
+    
+    OutcomeRecord record;
+    memset(&record, 0, sizeof(record));
+    time_t now = time(NULL);
+    record.time = now > 1600000000 ? (uint32_t)now : 0;  // Unset clock starts at 1970
+    record.durationMs = millis() - _attempt.startMs;
+    record.bytes = _attempt.bytes;
+    record.bytesPerSec = _attempt.downloadMs ? (uint64_t)_attempt.bytes * 1000 / _attempt.downloadMs : 0;
+    record.result = result;
+    record.attempts = _attempt.attempts;
+    record.error = _attempt.error;
+    snprintf(record.fromVersion, sizeof(record.fromVersion), "%s", _currentVersion);
+    snprintf(record.toVersion, sizeof(record.toVersion), "%s", targetVersion);
+    
+    Preferences prefs;
+    if (!prefs.begin(OTA_NVS_NAMESPACE, false)) {
+        log("ERROR: Cannot open NVS for outcome report");
+        return;
+    }
+    
+    OutcomeRing ring;
+    memset(&ring, 0, sizeof(ring));
+    if (prefs.getBytesLength(REPORT_NVS_KEY) == sizeof(ring)) {
+        prefs.getBytes(REPORT_NVS_KEY, &ring, sizeof(ring));
+    }
+    if (ring.count > MAX_REPORTS) ring.count = 0;
+    
+    if (ring.count == MAX_REPORTS) {
+        // Full - drop the oldest
+        memmove(&ring.records[0], &ring.records[1], (MAX_REPORTS - 1) * sizeof(OutcomeRecord));
+        ring.count--;
+    }
+    ring.records[ring.count++] = record;
+    
+    prefs.putBytes(REPORT_NVS_KEY, &ring, sizeof(ring));
+    prefs.end();
+    log("Outcome recorded (%u pending)", ring.count);
+}
+
+size_t AwsOta::loadReportBatch(uint8_t* buffer, size_t size) {
+    if (!_reportUrl[0] || size < REPORT_BATCH_MAX_SIZE) return 0;
+    
+    Preferences prefs;
+    if (!prefs.begin(OTA_NVS_NAMESPACE, false)) return 0;  // Read-only open fails until the namespace exists
+    
+    OutcomeRing ring;
+    bool loaded = prefs.getBytesLength(REPORT_NVS_KEY) == sizeof(ring) &&
+                  prefs.getBytes(REPORT_NVS_KEY, &ring, sizeof(ring)) == sizeof(ring);
+    prefs.end();
+    if (!loaded || ring.count == 0 || ring.count > MAX_REPORTS) return 0;
+    
+    uint8_t* p = buffer;
+    memcpy(p, "AORP", 4);
+    p[4] = REPORT_FORMAT_VERSION;
+    p[5] = ring.count;
+    p[6] = p[7] = 0;
+    WiFi.macAddress(p + 8);
+    p[14] = p[15] = 0;
+    p += REPORT_HEADER_SIZE;
+    
+    for (uint8_t i = 0; i < ring.count; i++) {
+        const OutcomeRecord& record = ring.records[i];
+        p = writeLe32(p, record.time);
+        p = writeLe32(p, record.durationMs);
+        p = writeLe32(p, record.bytes);
+        p = writeLe32(p, record.bytesPerSec);
+        *p++ = record.result;
+        *p++ = record.attempts;
+        *p++ = (uint16_t)record.error;
+        *p++ = (uint16_t)record.error >> 8;
+        p = writeVersion(p, record.fromVersion);
+        p = writeVersion(p, record.toVersion);
+    }
+    
+    return p - buffer;
+}
+
+bool AwsOta::uploadReports(const uint8_t* batch, size_t length) {
+    log("Uploading %u outcome report(s), %u bytes", batch[5], length);
+    
+    // Same connection as the manifest when the host matches
+    OtaHeader_t headers[] = {{"Content-Type", "application/octet-stream"}};
+    int code = _transport->request("POST", _reportUrl, headers, 1, false, batch, length);
+    _transport->end();
+    
+    if (code < 200 || code >= 300) {
+        log("Report upload failed: HTTP %d (kept for next check)", code);
+        return false;
+    }
+    
+    Preferences prefs;
+    if (prefs.begin(OTA_NVS_NAMESPACE, false)) {
+        prefs.remove(REPORT_NVS_KEY);
+        prefs.end();
+    }
+    log("Outcome reports delivered");
+    return true;
+}
+
+// Hash [offset, offset + length) of a flash partition
+static bool hashPartitionRange(const esp_partition_t* partition, uint32_t offset, uint32_t length,
+                               uint8_t* buffer, size_t bufferSize, uint8_t* hashOut) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);  // SHA-256, not SHA-224
+    
+    bool ok = true;
+    while (length > 0) {
+        uint32_t n = min(length, (uint32_t)bufferSize);
+        if (esp_partition_read(partition, offset, buffer, n) != ESP_OK) {
+            ok = false;
+            break;
+        }
+        mbedtls_sha256_update(&ctx, buffer, n);
+        offset += n;
+        length -= n;
+    }
+    
+    mbedtls_sha256_finish(&ctx, hashOut);
+    mbedtls_sha256_free(&ctx);
+    return ok;
+}
+
+bool AwsOta::downloadIncremental(const char* downloadUrl, const char* blocksUrl) {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (!running) {
+        log("ERROR: Running partition not found");
+        return false;
+    }
+    
+    log("Fetching block list from: %s", blocksUrl);
+    
+    int code = _transport->request("GET", blocksUrl, NULL, 0, true);  // Block list and image usually share a host
+    if (code != HTTP_CODE_OK) {
+        log("HTTP error: %d", code);
+        _transport->end();
+        return false;
+    }
+    
+    uint8_t header[BLOCKS_HEADER_SIZE];
+    
+    if (!readExact(header, sizeof(header)) || memcmp(header, "AOTB", 4) != 0 ||
+        header[4] != BLOCKS_FORMAT_VERSION || header[5] != BLOCKS_HASH_LEN) {
+        log("ERROR: Invalid block list header");
+        _transport->stop();
+        return false;
+    }
+    
+    uint32_t blockSize = readLe32(header + 8);
+    uint32_t imageSize = readLe32(header + 12);
+    
+    // Untrusted until checked - the bitmap below is sized from these
+    const esp_partition_t* target = esp_ota_get_next_update_partition(NULL);
+    if (blockSize < BLOCKS_MIN_BLOCK_SIZE || imageSize == 0 || !target || imageSize > target->size) {
+        log("ERROR: Invalid block list geometry (block %u, image %u bytes)", blockSize, imageSize);
+        _transport->stop();
+        return false;
+    }
+    
+    // Pass 1: hash the running image block by block against the list (one bit per block)
+    uint32_t blockCount = (imageSize + blockSize - 1) / blockSize;
+    std::vector<uint8_t> changed((blockCount + 7) / 8, 0);
+    uint32_t changedBlocks = 0;
+    uint8_t buff[512];
+    uint8_t remoteHash[BLOCKS_HASH_LEN];
+    uint8_t localHash[BLOCKS_HASH_LEN];
+    
+    log("Comparing %u blocks of %u bytes...", blockCount, blockSize);
+    
+    for (uint32_t i = 0; i < blockCount; i++) {
+        if (!readExact(remoteHash, sizeof(remoteHash))) {
+            log("ERROR: Truncated block list");
+            _transport->stop();
+            return false;
+        }
+        
+        uint32_t offset = i * blockSize;
+        uint32_t length = min(blockSize, imageSize - offset);
+        
+        bool same = offset + length <= running->size &&
+                    hashPartitionRange(running, offset, length, buff, sizeof(buff), localHash) &&
+                    memcmp(localHash, remoteHash, sizeof(localHash)) == 0;
+        if (!same) {
+            changed[i / 8] |= 1 << (i % 8);
+            changedBlocks++;
+        }
+    }
+    _transport->end();
+    
+    log("%u of %u blocks changed", changedBlocks, blockCount);
+    
+    if (changedBlocks == blockCount) {
+        _transport->stop();
+        return false;  // Nothing to reuse - a single full GET is cheaper
+    }
+    
+    if (!Update.begin(imageSize)) {
+        log("ERROR: Update.begin() failed: %d", Update.getError());
+        _transport->stop();
+        return false;
+    }
+    
+    // Pass 2: copy unchanged runs from flash, fetch changed runs with one Range request each
+    size_t written = 0;
+    size_t downloaded = 0;
+    int ranges = 0;
+    int lastProgress = -1;
+    
+    log("Downloading and flashing changed blocks...");
+    
+    uint32_t i = 0;
+    while (i < blockCount) {
+        bool runChanged = changed[i / 8] & (1 << (i % 8));
+        uint32_t j = i + 1;
+        while (j < blockCount && (bool)(changed[j / 8] & (1 << (j % 8))) == runChanged) {
+            j++;
+        }
+        
+        uint32_t offset = i * blockSize;
+        uint32_t remaining = min(j * blockSize, imageSize) - offset;
+        bool ok = true;
+        
+        if (runChanged) {
+            ok = requestRange(downloadUrl, offset, remaining) == HTTP_CODE_PARTIAL_CONTENT;
+            downloaded += remaining;
+            ranges++;
+        }
+        
+        while (ok && remaining > 0) {
+            uint32_t n = min(remaining, (uint32_t)sizeof(buff));
+            if (runChanged) {
+                ok = readExact(buff, n);
+            } else {
+                ok = esp_partition_read(running, offset, buff, n) == ESP_OK;
+            }
+            if (ok && Update.write(buff, n) != n) {
+                log("ERROR: Update.write() failed");
+                ok = false;
+            }
+            offset += n;
+            remaining -= n;
+            written += n;
+            reportProgress(written, imageSize, lastProgress);
+        }
+        
+        if (runChanged) {
+            _transport->end();
+        }
+        
+        if (!ok) {
+            log("ERROR: Block transfer failed at offset %u", offset);
+            Update.abort();
+            _transport->stop();
+            return false;
+        }
+        i = j;
+    }
+    _transport->stop();
+    _attempt.bytes += downloaded;
+    
+    _state = OTA_STATE_VERIFYING;
+    if (!Update.end(true)) {
+        log("ERROR: Update.end() failed: %d", Update.getError());
+        _attempt.error = Update.getError();
+        return false;
+    }
+    
+    log("Flash successful! (%u bytes written, %u downloaded in %d ranges)", written, downloaded, ranges);
+    return true;
+}
+
+void AwsOta::reportProgress(size_t written, size_t total, int& lastProgress) {
+    int progress = (written * 100) / total;
+    if (progress != lastProgress && progress % 10 == 0) {
+        log("Progress: %d%%", progress);
+        if (_cbOnProgress) _cbOnProgress(progress);
+        lastProgress = progress;
+    }
+}
+
 // ========================================
 // AUTOMATIC TASK MANAGEMENT
 // ========================================
@@ -469,6 +1438,69 @@ void AwsOta::intervalCheckTask(void* parameter) {
     // Never reaches here
 }
 
+void AwsOta::pushCheckTask(void* parameter) {
+    AwsOta* ota = (AwsOta*)parameter;
+    
+    ota->log("Push check task started (fallback: %lu ms)", ota->_pushFallbackMs);
+    
+    uint8_t failures = 0;
+    
+    while (true) {
+        // A failed check is retried after 1, 2, 4, ... minutes, capped at the fallback.
+        // No fallback (0) = wait for pushes only.
+        unsigned long waitMs = ota->_pushFallbackMs;
+        if (failures > 0) {
+            unsigned long backoffMs = (unsigned long)WAKE_RETRY_BASE_SEC * 1000UL << min((int)failures - 1, 10);
+            waitMs = waitMs ? min(backoffMs, waitMs) : backoffMs;
+        }
+        
+        // Sleep until a push arrives or the next check is due.
+        // Divide instead of pdMS_TO_TICKS - that overflows past ~71 minutes.
+        TickType_t waitTicks = waitMs ? waitMs / portTICK_PERIOD_MS : portMAX_DELAY;
+        bool pushed = ulTaskNotifyTake(pdTRUE, waitTicks) > 0;
+        
+        // Wait for WiFi
+        while (WiFi.status() != WL_CONNECTED) {
+            vTaskDelay(pdMS_TO_TICKS(5000));
+        }
+        
+        if (pushed && ota->_pushSpreadMs > 0) {
+            vTaskDelay(pdMS_TO_TICKS(random(ota->_pushSpreadMs)));
+            ulTaskNotifyTake(pdTRUE, 0);  // Pushes during the spread are served by this check
+        }
+        
+        ota->log(pushed ? "Running push-triggered OTA check..." : "Running fallback OTA check...");
+        bool failed = false;
+        ota->performOtaUpdate(&failed);
+        failures = failed ? min(failures + 1, 31) : 0;
+    }
+    
+    // Never reaches here
+}
+
+void AwsOta::mqttEventHandler(void* handlerArgs, esp_event_base_t base, int32_t eventId, void* eventData) {
+    AwsOta* ota = (AwsOta*)handlerArgs;
+    esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)eventData;
+    
+    switch ((esp_mqtt_event_id_t)eventId) {
+        case MQTT_EVENT_CONNECTED:
+            ota->log("MQTT connected, subscribing to %s", ota->_pushTopic);
+            esp_mqtt_client_subscribe(event->client, ota->_pushTopic, 1);
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            ota->log("MQTT disconnected, will reconnect");
+            break;
+        case MQTT_EVENT_DATA:
+            if (event->current_data_offset == 0) {  // Large messages arrive in several parts
+                ota->log("OTA push received on %.*s", event->topic_len, event->topic);
+                xTaskNotifyGive(ota->_pushCheckTaskHandle);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 // ========================================
 // UTILITY FUNCTIONS
 // ========================================
@@ -34,14 +34,34 @@
 #endif
 
 #include <ArduinoJson.h>
+#include <mqtt_client.h>
+#include "OtaDecrypt.h"
+#include "OtaTransport.h"
+#include "OtaHttpClientTransport.h"
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 #include <vector>
 
+// Buffers for manifest parsing
+#define MAX_VERSION_LEN 32
+#define MAX_FIRMWARE_URL_LEN 512
+
 // Define callback function types (optional - for advanced users)
 typedef std::function<void(void)> OtaEventCallback_t;
 typedef std::function<void(const char* message)> OtaErrorCallback_t;
 typedef std::function<void(int progress)> OtaProgressCallback_t;
 
+// OTA state machine
+typedef enum {
+    OTA_STATE_IDLE,            // No check running
+    OTA_STATE_CHECKING,        // Fetching and comparing the manifest
+    OTA_STATE_DOWNLOADING,     // Downloading and writing firmware
+    OTA_STATE_VERIFYING,       // Validating the written image
+    OTA_STATE_PENDING_REBOOT   // New firmware installed, restart imminent
+} OtaState_t;
+
 class AwsOta {
 public:
     // ========================================
@@ -95,12 +115,38 @@ public:
      */
     void checkEvery(unsigned long intervalMs);
 
+    /**
+     * @brief Check for updates when notified over MQTT, with a slow fallback poll
+     * @param brokerUri MQTT broker (e.g., "mqtts://xxxx-ats.iot.eu-west-1.amazonaws.com:8883")
+     * @param topic Topic to subscribe to, per fleet or per device
+     * @param fallbackIntervalMs Check anyway after this long without a push (default: 24 hours, 0 = never)
+     * @param spreadMs Random delay 0..spreadMs after a push (default: 30 seconds)
+     * 
+     * Any message on the topic triggers a check through the same path as
+     * checkNow(), so rollouts propagate in seconds without short polling.
+     * The spread keeps a fleet-wide push from reaching S3 all at once.
+     * Uses the ESP-IDF MQTT client with a persistent QoS 1 session, so a
+     * push sent while the device was offline arrives when it reconnects.
+     * The broker is verified with the root CA passed to begin().
+     * With no fallback, only pushes (and retries of a failed check) cause
+     * checks - pair it with checkOnBoot() so a device that missed pushes
+     * while powered off still catches up.
+     * 
+     * @example
+     * ota.setPushClientCert(DEVICE_CERT, DEVICE_KEY);  // AWS IoT Core
+     * ota.checkOnPush("mqtts://xxxx-ats.iot.eu-west-1.amazonaws.com:8883", "fleet/sensor-v3/ota");
+     */
+    void checkOnPush(const char* brokerUri, const char* topic,
+                     unsigned long fallbackIntervalMs = 86400000, unsigned long spreadMs = 30000);
+
     /**
      * @brief Check for updates RIGHT NOW (blocking call)
      * @return true if update was successful, false otherwise
      * 
      * Use this for manual triggers (button press, MQTT command, etc.)
-     * This will block until complete!
+     * This will block until complete! If a check is already running
+     * (boot or interval task), waits for it and returns its result
+     * instead of starting a second one. Safe to call from any task.
      * 
      * @example
      * if (buttonPressed) {
@@ -111,6 +157,49 @@ public:
      */
     bool checkNow();
 
+    /**
+     * @brief Get the current OTA state (safe to call from any task)
+     * 
+     * @example
+     * if (ota.getState() == OTA_STATE_DOWNLOADING) showSpinner();
+     */
+    OtaState_t getState();
+
+    /**
+     * @brief Remember check results across deep sleep and only check when due
+     * @param intervalSeconds Minimum time between successful checks
+     * 
+     * The last check time, manifest ETag and retry backoff are kept in RTC
+     * memory. checkOnBoot() then decides in microseconds whether a check is
+     * due and skips WiFi, TLS and the manifest request entirely when not.
+     * Failed checks are retried with exponential backoff (1 min, 2 min, ...
+     * capped at intervalSeconds). Relies on the system clock, which keeps
+     * running through deep sleep; a cold boot always checks.
+     * 
+     * @example
+     * ota.setWakeCheckInterval(6 * 3600);  // At most every 6 hours
+     * ota.checkOnBoot(0);
+     */
+    void setWakeCheckInterval(uint32_t intervalSeconds);
+
+    /**
+     * @brief Is an update check due now? (no network access)
+     * @return true if no wake interval is set, or the interval/backoff has elapsed
+     */
+    bool isCheckDue();
+
+    /**
+     * @brief Seconds until the next check is due (0 = due now)
+     * 
+     * Use it to fit your deep sleep duration around the next check.
+     * 
+     * @example
+     * uint32_t sleepSec = ota.secondsUntilNextCheck();
+     * if (sleepSec == 0 || sleepSec > 300) sleepSec = 300;
+     * esp_sleep_enable_timer_wakeup(sleepSec * 1000000ULL);
+     */
+    uint32_t secondsUntilNextCheck();
+
     // ========================================
     // CONFIGURATION (Optional)
     // ========================================
@@ -156,6 +245,102 @@ public:
      */
     void setHttpTimeout(int timeoutSeconds);
 
+    /**
+     * @brief Use a fleet-wide binary manifest instead of a per-device JSON one
+     * @param hardwareId Hardware variant ID of this device (max 16 chars)
+     * @param channel Release channel (max 8 chars, default: "stable")
+     * 
+     * The manifest URL passed to begin() must then point to a fleet table
+     * built with extras/tools/fleet_manifest.py. The device looks up its own
+     * (hardwareId, channel) entry with HTTP Range requests and binary search,
+     * so memory use stays constant no matter how large the fleet grows.
+     * Servers that ignore Range are handled by scanning the stream and
+     * stopping as soon as the entry is found. Entries can carry the same
+     * enc/iv/tag as a JSON manifest (see storeDecryptionKey()).
+     * 
+     * @example
+     * ota.begin("https://bucket.s3.amazonaws.com/fleet.bin", "1.0.0", AWS_ROOT_CA);
+     * ota.setFleetManifest("sensor-v3", "beta");
+     */
+    void setFleetManifest(const char* hardwareId, const char* channel = "stable");
+
+    /**
+     * @brief Enable/disable incremental (block-hash) sync
+     * @param enabled true = use the manifest "blocks" list when present (default)
+     * 
+     * When the manifest has a "blocks" URL (built with extras/tools/block_list.py),
+     * the device hashes its running firmware block by block, copies unchanged
+     * blocks locally and downloads only the changed ones. Falls back to a
+     * normal full download if that is not possible.
+     * 
+     * @example
+     * ota.setIncrementalSync(false);  // Always download the full image
+     */
+    void setIncrementalSync(bool enabled);
+
+    /**
+     * @brief Send update outcome reports to a fleet endpoint
+     * @param url HTTPS URL that accepts the batched reports (POST)
+     * 
+     * Every update attempt (and every failed manifest fetch) leaves a record
+     * in a small NVS ring: versions, result, attempts, duration, bytes,
+     * throughput and error code. At the next successful manifest check all
+     * pending records are sent as one compact binary POST over the same
+     * connection, then cleared. This works with JSON and fleet manifests
+     * (after the fleet lookup). Endpoint must be on the manifest's host for
+     * the connection to be reused. Format: see extras/tools/report_collector.py
+     * 
+     * @example
+     * ota.setReportEndpoint("https://api.example.com/ota/reports");
+     */
+    void setReportEndpoint(const char* url);
+
+    /**
+     * @brief Use another HTTP transport for manifest, firmware and report requests
+     * @param transport Backend, must stay valid (NULL = default HTTPClient transport)
+     * 
+     * OtaEspHttpTransport uses esp_http_client directly with tunable buffers.
+     * OtaSocketTransport fetches plain http:// URLs from a trusted LAN mirror.
+     * Manifest and firmware URLs must use a scheme the transport supports.
+     * Call before starting checks. Compare the transports on your own network
+     * with examples/TransportBenchmark.
+     * 
+     * @example
+     * #include <OtaEspHttpTransport.h>
+     * OtaEspHttpTransport transport(16384);  // 16 KB receive buffer
+     * ota.setTransport(&transport);
+     */
+    void setTransport(OtaTransport* transport);
+
+    /**
+     * @brief Client certificate for brokers with mutual TLS (call before checkOnPush)
+     * @param clientCert Device certificate (PEM), must stay valid
+     * @param clientKey Device private key (PEM), must stay valid
+     */
+    void setPushClientCert(const char* clientCert, const char* clientKey);
+
+    /**
+     * @brief Store the firmware decryption key in this device's NVS key slot
+     * @param key AES key, 16 or 32 bytes
+     * @return true if stored
+     * 
+     * Run once when provisioning the device (ideally with NVS encryption
+     * enabled). Manifests can then point at encrypted images:
+     * {"version":"1.2.0","url":"https://.../fw.enc","enc":"aes-gcm",
+     *  "iv":"<24 hex chars>","tag":"<32 hex chars>"}
+     * "aes-ctr" takes a 32 hex char iv (initial counter block) and no tag.
+     * Images are decrypted chunk by chunk between the download stream and
+     * Update.write() on the AES hardware; a GCM image whose tag does not
+     * match is never marked bootable. Encrypted images always use a full
+     * download (no incremental sync). Build them with extras/tools/encrypt_image.py;
+     * with setFleetManifest() the fields go in the entry given to fleet_manifest.py.
+     * 
+     * @example
+     * const uint8_t key[32] = { ... };
+     * ota.storeDecryptionKey(key, sizeof(key));
+     */
+    bool storeDecryptionKey(const uint8_t* key, size_t length);
+
     // ========================================
     // ADVANCED API (Optional Callbacks)
     // ========================================
@@ -198,16 +383,42 @@ private:
     char _manifestUrl[256];
     char _currentVersion[32];
     const char* _awsRootCa = NULL;
+    char _fleetHardwareId[17] = {0};
+    char _fleetChannel[9] = {0};
 
     int _maxRetries = 3;
     int _httpTimeout = 120;  // Hard timeout in seconds
     bool _debugMode = true;
     bool _autoTaskSuspend = true;
+    bool _incrementalSync = true;
     
     TaskHandle_t _bootCheckTaskHandle = NULL;
     TaskHandle_t _intervalCheckTaskHandle = NULL;
+    TaskHandle_t _pushCheckTaskHandle = NULL;
     unsigned long _checkInterval = 0;
-    bool _isUpdating = false;
+    uint32_t _wakeCheckInterval = 0;  // 0 = wake scheduling disabled
+    char _reportUrl[256] = {0};       // Empty = outcome reporting disabled
+
+    // ---- Transport ----
+    OtaHttpClientTransport _defaultTransport;
+    OtaTransport* _transport = &_defaultTransport;
+
+    // ---- Push Trigger (MQTT) ----
+    esp_mqtt_client_handle_t _mqttClient = NULL;
+    char _pushTopic[128] = {0};
+    const char* _pushClientCert = NULL;
+    const char* _pushClientKey = NULL;
+    unsigned long _pushFallbackMs = 0;
+    unsigned long _pushSpreadMs = 0;
+
+    // ---- State Machine ----
+    std::atomic<OtaState_t> _state{OTA_STATE_IDLE};
+    std::mutex _stateMutex;                 // Guards the fields below
+    std::condition_variable _checkDone;     // Signalled when a check finishes
+    uint32_t _checkGeneration = 0;          // Incremented per finished check
+    bool _lastCheckResult = false;
+    bool _lastCheckFailed = false;          // Error, as opposed to "no update"
+    TaskHandle_t _checkOwner = NULL;        // Task running the current check
 
     // ---- Private Callbacks (Optional) ----
     OtaEventCallback_t _cbOnStart = nullptr;
@@ -216,22 +427,127 @@ private:
     OtaEventCallback_t _cbOnNoUpdate = nullptr;
     OtaProgressCallback_t _cbOnProgress = nullptr;
 
+    // ---- Manifest Contents ----
+    struct OtaManifest {
+        char version[MAX_VERSION_LEN];
+        char url[MAX_FIRMWARE_URL_LEN];
+        char blocksUrl[MAX_FIRMWARE_URL_LEN];  // Optional block-hash list
+        OtaCipher_t cipher;                    // Image encryption ("enc")
+        uint8_t iv[OTA_AES_BLOCK_SIZE];
+        uint8_t ivLength;
+        uint8_t tag[OTA_GCM_TAG_SIZE];         // GCM only
+    };
+
+    // ---- Current Attempt (for outcome reports) ----
+    struct OtaAttempt {
+        uint32_t startMs;
+        uint32_t downloadMs;
+        uint32_t bytes;       // Firmware bytes received
+        uint8_t attempts;     // Manifest requests made
+        int16_t error;        // Last HTTP or Update error
+    };
+    OtaAttempt _attempt = {};
+
     // ---- Private Helper Methods ----
 
+    /**
+     * @brief Run a check, or join the one already in flight
+     * @param failed If set, receives whether the check hit an error (as opposed to "no update")
+     */
+    bool performOtaUpdate(bool* failed = NULL);
+
     /**
      * @brief Core OTA logic - fetches manifest, downloads, flashes
+     * @param failed Set to whether the check hit an error
      */
-    bool performOtaUpdate();
+    bool runOtaUpdate(bool& failed);
+
+    /**
+     * @brief Publish a check result to waiters and leave the check state
+     * 
+     * Never blocks while other tasks are suspended: the result is stored
+     * without waking waiters (they stay blocked until the restart), and if
+     * a suspended task holds the state lock only the state is updated.
+     */
+    void finishCheck(bool result, bool failed, OtaState_t nextState);
 
     /**
      * @brief Fetch manifest JSON from API
      */
-    bool fetchManifest(char* remoteVersion, size_t versionSize, char* downloadUrl, size_t urlSize);
+    bool fetchManifest(OtaManifest& manifest);
+
+    /**
+     * @brief Look up this device's entry in a binary fleet manifest
+     */
+    bool fetchFleetManifest(OtaManifest& manifest);
 
     /**
-     * @brief Download and flash firmware from URL
+     * @brief Start a GET for part of a URL (Range: bytes=offset..offset+length-1)
+     * @return HTTP status code (206 = range honoured, 200 = whole document)
      */
-    bool downloadAndFlash(const char* downloadUrl);
+    int requestRange(const char* url, uint32_t offset, uint32_t length);
+
+    /**
+     * @brief Read exactly length bytes of the response body
+     */
+    bool readExact(uint8_t* buffer, size_t length);
+
+    /**
+     * @brief Read and discard exactly length bytes of the response body
+     */
+    bool skipExact(size_t length);
+
+    /**
+     * @brief Read a whole (small) response body
+     */
+    bool readBody(std::vector<char>& body);
+
+    /**
+     * @brief Update the RTC-persisted check schedule after a check
+     */
+    void recordCheckResult(bool success);
+
+    /**
+     * @brief Append the current attempt to the NVS outcome ring
+     */
+    void recordOutcome(uint8_t result, const char* targetVersion);
+
+    /**
+     * @brief Encode pending outcome records into a report batch
+     * @return Batch length, 0 if there is nothing to send
+     */
+    size_t loadReportBatch(uint8_t* buffer, size_t size);
+
+    /**
+     * @brief POST a report batch on the manifest connection, clear it on success
+     */
+    bool uploadReports(const uint8_t* batch, size_t length);
+
+    /**
+     * @brief Parse the optional "enc"/"iv"/"tag" manifest fields
+     */
+    bool parseEncryption(JsonDocument& doc, OtaManifest& manifest);
+
+    /**
+     * @brief Set up decryption with the key from the NVS key slot
+     */
+    bool beginDecrypt(OtaDecrypt& decrypt, const OtaManifest& manifest);
+
+    /**
+     * @brief Download (and decrypt, if encrypted) and flash the manifest's firmware
+     */
+    bool downloadAndFlash(const OtaManifest& manifest);
+
+    /**
+     * @brief Flash by copying unchanged blocks from the running partition
+     *        and fetching only changed blocks with Range requests
+     */
+    bool downloadIncremental(const char* downloadUrl, const char* blocksUrl);
+
+    /**
+     * @brief Log and report download progress in 10% steps
+     */
+    void reportProgress(size_t written, size_t total, int& lastProgress);
 
     /**
      * @brief Automatically suspend all FreeRTOS tasks (except current)
@@ -253,6 +569,16 @@ private:
      */
     static void intervalCheckTask(void* parameter);
 
+    /**
+     * @brief Push check task - waits for an MQTT notification or the fallback timeout
+     */
+    static void pushCheckTask(void* parameter);
+
+    /**
+     * @brief MQTT client events (runs in the MQTT task)
+     */
+    static void mqttEventHandler(void* handlerArgs, esp_event_base_t base, int32_t eventId, void* eventData);
+
     /**
      * @brief Internal logging
      */
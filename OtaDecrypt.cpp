@@ -0,0 +1,110 @@
+/**
+ * @file OtaDecrypt.cpp
+ * @brief Streaming AES-CTR / AES-GCM firmware decryption
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ */
+
+#include "OtaDecrypt.h"
+#include <string.h>
+#include <mbedtls/platform_util.h>
+#include <mbedtls/version.h>
+
+OtaDecrypt::OtaDecrypt() {
+    mbedtls_aes_init(&_aes);
+    mbedtls_gcm_init(&_gcm);
+}
+
+OtaDecrypt::~OtaDecrypt() {
+    end();
+}
+
+bool OtaDecrypt::begin(OtaCipher_t cipher, const uint8_t* key, size_t keyLength, const uint8_t* iv, size_t ivLength) {
+    end();
+    if (keyLength != 16 && keyLength != 32) return false;
+
+    int ret = -1;
+    switch (cipher) {
+        case OTA_CIPHER_AES_CTR:
+            if (ivLength != OTA_AES_BLOCK_SIZE) return false;
+            // CTR only ever runs the cipher forwards - encryption key schedule
+            ret = mbedtls_aes_setkey_enc(&_aes, key, keyLength * 8);
+            memcpy(_counter, iv, OTA_AES_BLOCK_SIZE);
+            _keystreamOffset = 0;
+            break;
+
+        case OTA_CIPHER_AES_GCM:
+            if (ivLength == 0 || ivLength > OTA_AES_BLOCK_SIZE) return false;
+            ret = mbedtls_gcm_setkey(&_gcm, MBEDTLS_CIPHER_ID_AES, key, keyLength * 8);
+            if (ret == 0) {
+#if MBEDTLS_VERSION_MAJOR >= 3
+                ret = mbedtls_gcm_starts(&_gcm, MBEDTLS_GCM_DECRYPT, iv, ivLength);
+#else
+                ret = mbedtls_gcm_starts(&_gcm, MBEDTLS_GCM_DECRYPT, iv, ivLength, NULL, 0);
+#endif
+            }
+            break;
+
+        default:
+            return false;
+    }
+
+    if (ret != 0) {
+        end();
+        return false;
+    }
+    _cipher = cipher;
+    return true;
+}
+
+bool OtaDecrypt::update(uint8_t* data, size_t length) {
+    switch (_cipher) {
+        case OTA_CIPHER_AES_CTR:
+            return mbedtls_aes_crypt_ctr(&_aes, length, &_keystreamOffset, _counter, _keystream, data, data) == 0;
+
+        case OTA_CIPHER_AES_GCM: {
+#if MBEDTLS_VERSION_MAJOR >= 3
+            size_t produced = 0;
+            return mbedtls_gcm_update(&_gcm, data, length, data, length, &produced) == 0 && produced == length;
+#else
+            return mbedtls_gcm_update(&_gcm, length, data, data) == 0;
+#endif
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool OtaDecrypt::finish(const uint8_t* tag, size_t tagLength) {
+    if (_cipher == OTA_CIPHER_AES_CTR) return true;
+    if (_cipher != OTA_CIPHER_AES_GCM || tagLength != OTA_GCM_TAG_SIZE) return false;
+
+    uint8_t computed[OTA_GCM_TAG_SIZE];
+#if MBEDTLS_VERSION_MAJOR >= 3
+    size_t produced = 0;
+    if (mbedtls_gcm_finish(&_gcm, NULL, 0, &produced, computed, sizeof(computed)) != 0) return false;
+#else
+    if (mbedtls_gcm_finish(&_gcm, computed, sizeof(computed)) != 0) return false;
+#endif
+
+    // Constant-time compare
+    uint8_t diff = 0;
+    for (size_t i = 0; i < sizeof(computed); i++) {
+        diff |= computed[i] ^ tag[i];
+    }
+    return diff == 0;
+}
+
+void OtaDecrypt::end() {
+    // Free also wipes the key schedules
+    mbedtls_aes_free(&_aes);
+    mbedtls_gcm_free(&_gcm);
+    mbedtls_aes_init(&_aes);
+    mbedtls_gcm_init(&_gcm);
+    mbedtls_platform_zeroize(_counter, sizeof(_counter));
+    mbedtls_platform_zeroize(_keystream, sizeof(_keystream));
+    _keystreamOffset = 0;
+    _cipher = OTA_CIPHER_NONE;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file OtaDecrypt.h
+ * @brief Streaming AES-CTR / AES-GCM decryption of firmware chunks, in place
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ *
+ * @note Uses the mbedtls AES API, which ESP-IDF routes to the AES hardware
+ *       accelerator (MBEDTLS_AES_ALT). Has no Arduino dependencies so the
+ *       host benchmark in extras/decrypt_bench builds the same code.
+ */
+
+#ifndef OTA_DECRYPT_H
+#define OTA_DECRYPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mbedtls/aes.h>
+#include <mbedtls/gcm.h>
+
+#define OTA_AES_BLOCK_SIZE 16
+#define OTA_GCM_TAG_SIZE 16
+
+// ========================================
+// TYPE DEFINITIONS
+// ========================================
+
+typedef enum {
+    OTA_CIPHER_NONE,
+    OTA_CIPHER_AES_CTR,  // iv = 16-byte initial counter block, no authentication
+    OTA_CIPHER_AES_GCM   // iv = 12-byte nonce, 16-byte tag checked at the end
+} OtaCipher_t;
+
+class OtaDecrypt {
+public:
+    OtaDecrypt();
+    ~OtaDecrypt();
+
+    /**
+     * @brief Set up decryption of one image
+     * @param key AES-128 or AES-256 key (keyLength 16 or 32)
+     * @return false on a bad key/IV length or mbedtls error
+     */
+    bool begin(OtaCipher_t cipher, const uint8_t* key, size_t keyLength, const uint8_t* iv, size_t ivLength);
+
+    /**
+     * @brief Decrypt the next chunk of the image in place
+     *
+     * With GCM every chunk except the last must be a multiple of
+     * OTA_AES_BLOCK_SIZE (mbedtls 2.x processes whole blocks per call).
+     */
+    bool update(uint8_t* data, size_t length);
+
+    /**
+     * @brief Finish the image; for GCM compares the tag in constant time
+     * @return true if the image is authentic (always true for CTR)
+     */
+    bool finish(const uint8_t* tag, size_t tagLength);
+
+    /**
+     * @brief Wipe key material (also done by the destructor)
+     */
+    void end();
+
+    OtaCipher_t cipher() const { return _cipher; }
+
+private:
+    OtaCipher_t _cipher = OTA_CIPHER_NONE;
+    mbedtls_aes_context _aes;
+    mbedtls_gcm_context _gcm;
+    uint8_t _counter[OTA_AES_BLOCK_SIZE];
+    uint8_t _keystream[OTA_AES_BLOCK_SIZE];
+    size_t _keystreamOffset = 0;
+};
+
+#endif // OTA_DECRYPT_H
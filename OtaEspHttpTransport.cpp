@@ -0,0 +1,137 @@
+/**
+ * @file OtaEspHttpTransport.cpp
+ * @brief OtaTransport on ESP-IDF esp_http_client / esp-tls
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ */
+
+#include "OtaEspHttpTransport.h"
+#include <string.h>
+#include <strings.h>
+
+OtaEspHttpTransport::OtaEspHttpTransport(int rxBufferSize, int txBufferSize)
+    : _rxBufferSize(rxBufferSize), _txBufferSize(txBufferSize) {
+}
+
+OtaEspHttpTransport::~OtaEspHttpTransport() {
+    stop();
+}
+
+void OtaEspHttpTransport::configure(const char* rootCa, uint32_t timeoutMs) {
+    if (rootCa != _rootCa || timeoutMs != _timeoutMs) {
+        stop();  // Settings are fixed per handle
+    }
+    _rootCa = rootCa;
+    _timeoutMs = timeoutMs;
+}
+
+bool OtaEspHttpTransport::supports(const char* url) {
+    return strncmp(url, "https://", 8) == 0;
+}
+
+int OtaEspHttpTransport::request(const char* method, const char* url, const OtaHeader_t* headers,
+                                 size_t headerCount, bool keepAlive, const uint8_t* body, size_t bodyLength) {
+    if (headerCount > OTA_ESP_HTTP_MAX_HEADERS) return -1;
+
+    bool reused = _client != NULL;
+    if (!_client) {
+        esp_http_client_config_t config = {};
+        config.url = url;
+        config.cert_pem = _rootCa;
+        config.timeout_ms = (int)_timeoutMs;
+        config.buffer_size = _rxBufferSize;
+        config.buffer_size_tx = _txBufferSize;
+        config.event_handler = eventHandler;
+        config.user_data = this;
+        _client = esp_http_client_init(&config);
+        if (!_client) return -1;
+        _headerCount = 0;
+    } else if (esp_http_client_set_url(_client, url) != ESP_OK) {  // Closes the connection on a host change
+        return -1;
+    }
+
+    // Headers stay on the handle - drop the previous request's
+    for (size_t i = 0; i < _headerCount; i++) {
+        esp_http_client_delete_header(_client, _headerNames[i]);
+    }
+    _headerCount = 0;
+    for (size_t i = 0; i < headerCount; i++) {
+        if (strlen(headers[i].name) >= sizeof(_headerNames[0])) return -1;
+        esp_http_client_set_header(_client, headers[i].name, headers[i].value);
+        strcpy(_headerNames[_headerCount++], headers[i].name);
+    }
+
+    _keepAlive = keepAlive;
+    esp_http_client_set_header(_client, "Connection", keepAlive ? "keep-alive" : "close");
+    esp_http_client_set_method(_client, strcmp(method, "POST") == 0 ? HTTP_METHOD_POST : HTTP_METHOD_GET);
+
+    int status = send(body, bodyLength);
+    if (status < 0 && reused) {
+        // The server may have closed the kept connection in the meantime
+        esp_http_client_close(_client);
+        status = send(body, bodyLength);
+    }
+    if (status < 0) {
+        esp_http_client_close(_client);
+    }
+    return status;
+}
+
+int OtaEspHttpTransport::send(const uint8_t* body, size_t bodyLength) {
+    for (int redirects = 0;; redirects++) {
+        _etag[0] = '\0';
+        _contentLength = -1;
+
+        if (esp_http_client_open(_client, bodyLength) != ESP_OK) return -1;
+        if (bodyLength > 0 && esp_http_client_write(_client, (const char*)body, bodyLength) != (int)bodyLength) {
+            return -1;
+        }
+        int64_t length = esp_http_client_fetch_headers(_client);
+        if (length < 0) return -1;
+        if (!esp_http_client_is_chunked_response(_client)) {
+            _contentLength = (int)length;
+        }
+
+        int status = esp_http_client_get_status_code(_client);
+        bool redirect = status == 301 || status == 302 || status == 307 || status == 308;
+        if (!redirect || bodyLength > 0 || redirects == OTA_ESP_HTTP_MAX_REDIRECTS) {
+            return status;
+        }
+
+        // Follow like HTTPC_STRICT_FOLLOW_REDIRECTS: GET only, body discarded
+        char discard[64];
+        while (esp_http_client_read(_client, discard, sizeof(discard)) > 0) {
+        }
+        if (esp_http_client_set_redirection(_client) != ESP_OK) return status;
+    }
+}
+
+int OtaEspHttpTransport::read(uint8_t* buffer, size_t length) {
+    if (!_client) return -1;
+    return esp_http_client_read(_client, (char*)buffer, length);
+}
+
+void OtaEspHttpTransport::end() {
+    if (_client && (!_keepAlive || !esp_http_client_is_complete_data_received(_client))) {
+        esp_http_client_close(_client);
+    }
+}
+
+void OtaEspHttpTransport::stop() {
+    if (_client) {
+        esp_http_client_close(_client);
+        esp_http_client_cleanup(_client);
+        _client = NULL;
+    }
+    _headerCount = 0;
+}
+
+esp_err_t OtaEspHttpTransport::eventHandler(esp_http_client_event_t* event) {
+    OtaEspHttpTransport* transport = (OtaEspHttpTransport*)event->user_data;
+    if (event->event_id == HTTP_EVENT_ON_HEADER && strcasecmp(event->header_key, "ETag") == 0 &&
+        strlen(event->header_value) < sizeof(transport->_etag)) {
+        strcpy(transport->_etag, event->header_value);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file OtaEspHttpTransport.h
+ * @brief OtaTransport on ESP-IDF esp_http_client / esp-tls
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ *
+ * Reads go straight from esp-tls into esp_http_client's receive buffer and
+ * from there into the caller's buffer, with no Arduino Stream layer in
+ * between. The buffer sizes are set per instance. The TLS record buffers
+ * are a build-time setting (CONFIG_MBEDTLS_SSL_IN_CONTENT_LEN) and cannot
+ * be changed here.
+ */
+
+#ifndef OTA_ESP_HTTP_TRANSPORT_H
+#define OTA_ESP_HTTP_TRANSPORT_H
+
+#include <esp_http_client.h>
+#include "OtaTransport.h"
+
+#define OTA_ESP_HTTP_MAX_HEADERS 6
+#define OTA_ESP_HTTP_MAX_REDIRECTS 5
+
+class OtaEspHttpTransport : public OtaTransport {
+public:
+    /**
+     * @brief Create the transport (no connection is made yet)
+     * @param rxBufferSize esp_http_client receive buffer in bytes (IDF default: 512)
+     * @param txBufferSize Buffer for the request line and headers (IDF default: 512)
+     *
+     * @example
+     * OtaEspHttpTransport transport(8192);
+     * ota.setTransport(&transport);
+     */
+    explicit OtaEspHttpTransport(int rxBufferSize = 4096, int txBufferSize = 1024);
+    ~OtaEspHttpTransport();
+
+    void configure(const char* rootCa, uint32_t timeoutMs) override;
+    bool supports(const char* url) override;
+    int request(const char* method, const char* url, const OtaHeader_t* headers, size_t headerCount,
+                bool keepAlive, const uint8_t* body = NULL, size_t bodyLength = 0) override;
+    int contentLength() override { return _contentLength; }
+    const char* etag() override { return _etag; }
+    int read(uint8_t* buffer, size_t length) override;
+    void end() override;
+    void stop() override;
+    const char* name() override { return "esp_http_client"; }
+
+private:
+    /**
+     * @brief Open, send body, fetch headers; follows GET redirects
+     */
+    int send(const uint8_t* body, size_t bodyLength);
+
+    static esp_err_t eventHandler(esp_http_client_event_t* event);
+
+    esp_http_client_handle_t _client = NULL;
+    const char* _rootCa = NULL;
+    uint32_t _timeoutMs = 120000;
+    int _rxBufferSize;
+    int _txBufferSize;
+    int _contentLength = -1;
+    bool _keepAlive = false;
+    char _headerNames[OTA_ESP_HTTP_MAX_HEADERS][32];  // Set on the handle by the last request
+    size_t _headerCount = 0;
+    char _etag[64] = {0};
+};
+
+#endif // OTA_ESP_HTTP_TRANSPORT_H
@@ -0,0 +1,119 @@
+/**
+ * @file OtaHttpClientTransport.cpp
+ * @brief Default OtaTransport: Arduino HTTPClient over WiFiClientSecure
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ */
+
+#include "OtaHttpClientTransport.h"
+
+void OtaHttpClientTransport::configure(const char* rootCa, uint32_t timeoutMs) {
+    _client.setCACert(rootCa);
+    _client.setTimeout(timeoutMs / 1000);  // Seconds
+    _timeoutMs = timeoutMs;
+}
+
+bool OtaHttpClientTransport::supports(const char* url) {
+    return strncmp(url, "https://", 8) == 0;
+}
+
+int OtaHttpClientTransport::request(const char* method, const char* url, const OtaHeader_t* headers,
+                                    size_t headerCount, bool keepAlive, const uint8_t* body, size_t bodyLength) {
+    char host[sizeof(_host)];
+    uint16_t port;
+    const char* path;
+    if (!parseUrl(url, host, sizeof(host), port, path)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    // setURL() carries a kept connection over but never reconnects on a host
+    // change, and begin() always drops it - so pick by host
+    bool reuse = _client.connected() && port == _port && strcmp(host, _host) == 0 && _http.setURL(url);
+    if (!reuse) {
+        _http.end();
+        _client.stop();
+        if (!_http.begin(_client, url)) {
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+        strcpy(_host, host);
+        _port = port;
+    }
+
+    _http.setTimeout(min(_timeoutMs, (uint32_t)UINT16_MAX));  // Takes a uint16_t
+    _http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+    _http.setReuse(keepAlive);
+    for (size_t i = 0; i < headerCount; i++) {
+        _http.addHeader(headers[i].name, headers[i].value);
+    }
+    const char* collect[] = {"ETag"};
+    _http.collectHeaders(collect, 1);
+
+    int code = _http.sendRequest(method, (uint8_t*)body, bodyLength);
+
+    _remaining = code > 0 ? _http.getSize() : 0;
+    _body = String();
+    _bodyOffset = 0;
+    _bodyBuffered = false;
+
+    String etag = _http.header("ETag");
+    _etag[0] = '\0';
+    if (etag.length() < sizeof(_etag)) {
+        strcpy(_etag, etag.c_str());  // Never store a truncated ETag
+    }
+    return code;
+}
+
+int OtaHttpClientTransport::contentLength() {
+    return _http.getSize();
+}
+
+const char* OtaHttpClientTransport::etag() {
+    return _etag;
+}
+
+int OtaHttpClientTransport::read(uint8_t* buffer, size_t length) {
+    if (_remaining < 0) {
+        // Unknown length (chunked) - let HTTPClient decode it, then serve from memory
+        if (!_bodyBuffered) {
+            _body = _http.getString();
+            _bodyBuffered = true;
+        }
+        size_t n = min(length, (size_t)(_body.length() - _bodyOffset));
+        memcpy(buffer, _body.c_str() + _bodyOffset, n);
+        _bodyOffset += n;
+        return n;
+    }
+    if (_remaining == 0) return 0;
+
+    WiFiClient* stream = _http.getStreamPtr();
+    if (!stream) return -1;
+
+    // Bulk read of whatever has arrived - Stream::readBytes() goes byte by byte
+    unsigned long start = millis();
+    int available;
+    while ((available = stream->available()) <= 0) {
+        if (!stream->connected() || millis() - start > _timeoutMs) return -1;
+        delay(1);
+    }
+    size_t n = min(length, min((size_t)available, (size_t)_remaining));
+    int got = stream->read(buffer, n);
+    if (got > 0) _remaining -= got;
+    return got;
+}
+
+void OtaHttpClientTransport::end() {
+    // A partly read body would end up in front of the next response
+    bool bodyDone = _remaining == 0 || (_remaining < 0 && _bodyBuffered);
+    _http.end();
+    if (!bodyDone) {
+        _client.stop();
+    }
+    _body = String();
+}
+
+void OtaHttpClientTransport::stop() {
+    _http.end();
+    _client.stop();
+    _body = String();
+}
@@ -0,0 +1,43 @@
+/**
+ * @file OtaHttpClientTransport.h
+ * @brief Default OtaTransport: Arduino HTTPClient over WiFiClientSecure
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ */
+
+#ifndef OTA_HTTP_CLIENT_TRANSPORT_H
+#define OTA_HTTP_CLIENT_TRANSPORT_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include "OtaTransport.h"
+
+class OtaHttpClientTransport : public OtaTransport {
+public:
+    void configure(const char* rootCa, uint32_t timeoutMs) override;
+    bool supports(const char* url) override;
+    int request(const char* method, const char* url, const OtaHeader_t* headers, size_t headerCount,
+                bool keepAlive, const uint8_t* body = NULL, size_t bodyLength = 0) override;
+    int contentLength() override;
+    const char* etag() override;
+    int read(uint8_t* buffer, size_t length) override;
+    void end() override;
+    void stop() override;
+    const char* name() override { return "HTTPClient"; }
+
+private:
+    WiFiClientSecure _client;
+    HTTPClient _http;
+    char _host[128] = {0};     // Host of the open connection
+    uint16_t _port = 0;
+    uint32_t _timeoutMs = 120000;
+    int _remaining = -1;       // Body bytes left, -1 = unknown length
+    String _body;              // Chunked bodies, decoded by getString()
+    size_t _bodyOffset = 0;
+    bool _bodyBuffered = false;
+    char _etag[64] = {0};
+};
+
+#endif // OTA_HTTP_CLIENT_TRANSPORT_H
@@ -0,0 +1,316 @@
+/**
+ * @file OtaSocketTransport.cpp
+ * @brief Plain-HTTP OtaTransport over BSD sockets (lwIP on the ESP32, POSIX on hosts)
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ */
+
+#include "OtaSocketTransport.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // No SIGPIPE to suppress
+#endif
+
+// snprintf at buffer + length; false once the buffer is full
+static bool appendf(char* buffer, size_t size, size_t& length, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer + length, size - length, format, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= size - length) return false;
+    length += n;
+    return true;
+}
+
+OtaSocketTransport::OtaSocketTransport(int receiveBufferSize) : _receiveBufferSize(receiveBufferSize) {
+}
+
+OtaSocketTransport::~OtaSocketTransport() {
+    stop();
+}
+
+void OtaSocketTransport::configure(const char* rootCa, uint32_t timeoutMs) {
+    _timeoutMs = timeoutMs;  // No TLS, no trust anchor
+}
+
+bool OtaSocketTransport::supports(const char* url) {
+    return strncmp(url, "http://", 7) == 0;
+}
+
+int OtaSocketTransport::request(const char* method, const char* url, const OtaHeader_t* headers,
+                                size_t headerCount, bool keepAlive, const uint8_t* body, size_t bodyLength) {
+    char host[sizeof(_host)];
+    uint16_t port;
+    const char* path;
+    if (!supports(url) || !parseUrl(url, host, sizeof(host), port, path)) return -1;
+
+    // Whole request head in one buffer, one send
+    char head[OTA_SOCKET_REQUEST_SIZE];
+    size_t length = 0;
+    bool fits = appendf(head, sizeof(head), length, "%s %s HTTP/1.1\r\nHost: %s", method, path, host);
+    if (port != 80) {
+        fits = fits && appendf(head, sizeof(head), length, ":%u", port);
+    }
+    fits = fits && appendf(head, sizeof(head), length, "\r\nConnection: %s\r\n", keepAlive ? "keep-alive" : "close");
+    if (body) {
+        fits = fits && appendf(head, sizeof(head), length, "Content-Length: %u\r\n", (unsigned)bodyLength);
+    }
+    for (size_t i = 0; i < headerCount; i++) {
+        fits = fits && appendf(head, sizeof(head), length, "%s: %s\r\n", headers[i].name, headers[i].value);
+    }
+    fits = fits && appendf(head, sizeof(head), length, "\r\n");
+    if (!fits) return -1;
+
+    bool reused = _socket >= 0 && port == _port && strcmp(host, _host) == 0;
+    for (;;) {
+        if (!reused) {
+            stop();
+            if (!connectTo(host, port)) return -1;
+            strcpy(_host, host);
+            _port = port;
+        }
+
+        int status = -1;
+        if (sendAll(head, length) && (bodyLength == 0 || sendAll(body, bodyLength))) {
+            status = readResponseHead(keepAlive);
+        }
+        if (status >= 0) return status;
+
+        stop();
+        if (!reused) return -1;
+        reused = false;  // The server may have closed the kept connection - retry once on a new one
+    }
+}
+
+int OtaSocketTransport::read(uint8_t* buffer, size_t length) {
+    if (_bodyDone) return 0;
+    if (_socket < 0) return -1;
+
+    if (_chunked && _remaining == 0) {
+        if (!nextChunk()) return -1;
+        if (_bodyDone) return 0;
+    }
+
+    size_t n = length;
+    if (_remaining > 0 && (int64_t)n > _remaining) {
+        n = (size_t)_remaining;
+    }
+    int got = receive(buffer, n);
+    if (got <= 0) {
+        if (got == 0 && _remaining < 0) {
+            _bodyDone = true;  // Body delimited by connection close
+            return 0;
+        }
+        return -1;
+    }
+
+    if (_remaining > 0) {
+        _remaining -= got;
+        if (_remaining == 0 && !_chunked) _bodyDone = true;
+    }
+    return got;
+}
+
+void OtaSocketTransport::end() {
+    if (!_reusable || !_bodyDone) {
+        stop();
+    }
+}
+
+void OtaSocketTransport::stop() {
+    if (_socket >= 0) {
+        close(_socket);
+        _socket = -1;
+    }
+    _host[0] = '\0';
+    _lookaheadStart = _lookaheadEnd = 0;
+}
+
+bool OtaSocketTransport::connectTo(const char* host, uint16_t port) {
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result = NULL;
+    if (getaddrinfo(host, service, &hints, &result) != 0 || !result) return false;
+
+    struct timeval timeout;
+    timeout.tv_sec = _timeoutMs / 1000;
+    timeout.tv_usec = (_timeoutMs % 1000) * 1000;
+
+    for (struct addrinfo* ai = result; ai && _socket < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+
+        if (_receiveBufferSize > 0) {
+            // Before connect(), so the window scale is negotiated for it
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &_receiveBufferSize, sizeof(_receiveBufferSize));
+        }
+
+        // Non-blocking connect bounded by the timeout
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        bool connected = connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+        if (!connected && errno == EINPROGRESS) {
+            fd_set writable;
+            FD_ZERO(&writable);
+            FD_SET(fd, &writable);
+            struct timeval wait = timeout;
+            int error = 0;
+            socklen_t errorLength = sizeof(error);
+            connected = select(fd + 1, NULL, &writable, NULL, &wait) == 1 &&
+                        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) == 0 && error == 0;
+        }
+        fcntl(fd, F_SETFL, flags);
+
+        if (connected) {
+            _socket = fd;
+        } else {
+            close(fd);
+        }
+    }
+    freeaddrinfo(result);
+    if (_socket < 0) return false;
+
+    int noDelay = 1;  // Request head and body go out as separate sends
+    setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    _lookaheadStart = _lookaheadEnd = 0;
+    return true;
+}
+
+bool OtaSocketTransport::sendAll(const void* data, size_t length) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (length > 0) {
+        ssize_t sent = send(_socket, p, length, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        p += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+int OtaSocketTransport::readResponseHead(bool keepAlive) {
+    char line[256];
+    int status;
+    int minor;
+    if (!readLine(line, sizeof(line)) || sscanf(line, "HTTP/1.%d %d", &minor, &status) != 2) return -1;
+
+    bool serverKeepAlive = minor >= 1;
+    _contentLength = -1;
+    _chunked = false;
+    _etag[0] = '\0';
+
+    for (;;) {
+        if (!readLine(line, sizeof(line))) return -1;
+        if (line[0] == '\0') break;  // End of headers
+
+        char* value = strchr(line, ':');
+        if (!value) continue;
+        *value++ = '\0';
+        while (*value == ' ' || *value == '\t') value++;
+
+        if (strcasecmp(line, "Content-Length") == 0) {
+            _contentLength = atoi(value);
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+            _chunked = strstr(value, "chunked") != NULL;
+        } else if (strcasecmp(line, "Connection") == 0) {
+            if (strcasecmp(value, "close") == 0) serverKeepAlive = false;
+            if (strcasecmp(value, "keep-alive") == 0) serverKeepAlive = true;
+        } else if (strcasecmp(line, "ETag") == 0 && strlen(value) < sizeof(_etag)) {
+            strcpy(_etag, value);
+        }
+    }
+
+    // Body framing
+    _bodyDone = false;
+    _firstChunk = _chunked;
+    if (status < 200 || status == 204 || status == 304) {
+        _contentLength = 0;
+        _chunked = false;
+        _remaining = 0;
+        _bodyDone = true;
+    } else if (_chunked) {
+        _contentLength = -1;
+        _remaining = 0;
+    } else if (_contentLength >= 0) {
+        _remaining = _contentLength;
+        _bodyDone = _contentLength == 0;
+    } else {
+        _remaining = -1;
+        serverKeepAlive = false;
+    }
+    _reusable = keepAlive && serverKeepAlive;
+    return status;
+}
+
+bool OtaSocketTransport::readLine(char* line, size_t size) {
+    size_t length = 0;
+    for (;;) {
+        if (_lookaheadStart == _lookaheadEnd) {
+            ssize_t got = recv(_socket, _lookahead, sizeof(_lookahead), 0);
+            if (got <= 0) return false;
+            _lookaheadStart = 0;
+            _lookaheadEnd = got;
+        }
+        char c = _lookahead[_lookaheadStart++];
+        if (c == '\n') break;
+        if (c != '\r' && length + 1 < size) line[length++] = c;
+    }
+    line[length] = '\0';
+    return true;
+}
+
+int OtaSocketTransport::receive(uint8_t* buffer, size_t length) {
+    if (_lookaheadStart < _lookaheadEnd) {
+        size_t n = _lookaheadEnd - _lookaheadStart;
+        if (n > length) n = length;
+        memcpy(buffer, _lookahead + _lookaheadStart, n);
+        _lookaheadStart += n;
+        return (int)n;
+    }
+    return (int)recv(_socket, buffer, length, 0);
+}
+
+bool OtaSocketTransport::nextChunk() {
+    char line[64];
+    if (!_firstChunk && !readLine(line, sizeof(line))) return false;  // CRLF after the previous chunk
+    _firstChunk = false;
+
+    if (!readLine(line, sizeof(line))) return false;
+    char* end;
+    long size = strtol(line, &end, 16);
+    if (end == line || size < 0) return false;
+
+    if (size == 0) {
+        // Trailers up to the empty line
+        do {
+            if (!readLine(line, sizeof(line))) return false;
+        } while (line[0] != '\0');
+        _bodyDone = true;
+        return true;
+    }
+    _remaining = size;
+    return true;
+}
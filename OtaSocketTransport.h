@@ -0,0 +1,93 @@
+/**
+ * @file OtaSocketTransport.h
+ * @brief Plain-HTTP OtaTransport over BSD sockets (lwIP on the ESP32, POSIX on hosts)
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ *
+ * For trusted LAN mirrors only: no TLS, so only http:// URLs are accepted
+ * and redirects are not followed. Pair it with encrypted images (GCM) if
+ * the network is not fully trusted. Body bytes are received straight into
+ * the caller's buffer; only the response head goes through a small lookahead
+ * buffer. Builds unchanged on Linux/macOS, which the host benchmark in
+ * extras/transport_bench relies on.
+ */
+
+#ifndef OTA_SOCKET_TRANSPORT_H
+#define OTA_SOCKET_TRANSPORT_H
+
+#include "OtaTransport.h"
+
+#define OTA_SOCKET_LOOKAHEAD_SIZE 512
+#define OTA_SOCKET_REQUEST_SIZE 1024
+
+class OtaSocketTransport : public OtaTransport {
+public:
+    /**
+     * @brief Create the transport (no connection is made yet)
+     * @param receiveBufferSize SO_RCVBUF in bytes, 0 = system default. On the
+     *        ESP32 the TCP window is fixed at build time (CONFIG_LWIP_TCP_WND_DEFAULT)
+     *
+     * @example
+     * OtaSocketTransport mirror;
+     * ota.setTransport(&mirror);
+     * ota.begin("http://192.168.1.10/firmware/manifest.json", "1.0.0", AWS_ROOT_CA);
+     */
+    explicit OtaSocketTransport(int receiveBufferSize = 0);
+    ~OtaSocketTransport();
+
+    void configure(const char* rootCa, uint32_t timeoutMs) override;
+    bool supports(const char* url) override;
+    int request(const char* method, const char* url, const OtaHeader_t* headers, size_t headerCount,
+                bool keepAlive, const uint8_t* body = NULL, size_t bodyLength = 0) override;
+    int contentLength() override { return _contentLength; }
+    const char* etag() override { return _etag; }
+    int read(uint8_t* buffer, size_t length) override;
+    void end() override;
+    void stop() override;
+    const char* name() override { return "socket"; }
+
+private:
+    bool connectTo(const char* host, uint16_t port);
+    bool sendAll(const void* data, size_t length);
+
+    /**
+     * @brief Status line and headers; sets up body framing
+     */
+    int readResponseHead(bool keepAlive);
+
+    /**
+     * @brief Read a CRLF-terminated line (truncated to size, rest discarded)
+     */
+    bool readLine(char* line, size_t size);
+
+    /**
+     * @brief Lookahead bytes first, then straight from the socket
+     */
+    int receive(uint8_t* buffer, size_t length);
+
+    /**
+     * @brief Parse the next chunk-size line (and trailers after the last chunk)
+     */
+    bool nextChunk();
+
+    int _socket = -1;
+    int _receiveBufferSize;
+    uint32_t _timeoutMs = 120000;
+    char _host[128] = {0};  // Host of the open connection
+    uint16_t _port = 0;
+
+    uint8_t _lookahead[OTA_SOCKET_LOOKAHEAD_SIZE];
+    size_t _lookaheadStart = 0;
+    size_t _lookaheadEnd = 0;
+
+    int _contentLength = -1;
+    int64_t _remaining = 0;      // Body (or current chunk) bytes left, -1 = until close
+    bool _chunked = false;
+    bool _firstChunk = false;
+    bool _bodyDone = false;
+    bool _reusable = false;      // Both sides agreed to keep the connection
+    char _etag[64] = {0};
+};
+
+#endif // OTA_SOCKET_TRANSPORT_H
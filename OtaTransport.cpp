@@ -0,0 +1,41 @@
+/**
+ * @file OtaTransport.cpp
+ * @brief Helpers shared by the OtaTransport backends
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ */
+
+#include "OtaTransport.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool OtaTransport::parseUrl(const char* url, char* host, size_t hostSize, uint16_t& port, const char*& path) {
+    const char* p;
+    if (strncmp(url, "https://", 8) == 0) {
+        p = url + 8;
+        port = 443;
+    } else if (strncmp(url, "http://", 7) == 0) {
+        p = url + 7;
+        port = 80;
+    } else {
+        return false;
+    }
+
+    size_t hostLength = strcspn(p, ":/?");
+    if (hostLength == 0 || hostLength >= hostSize) return false;
+    memcpy(host, p, hostLength);
+    host[hostLength] = '\0';
+    p += hostLength;
+
+    if (*p == ':') {
+        char* end;
+        long value = strtol(p + 1, &end, 10);
+        if (end == p + 1 || value <= 0 || value > 65535) return false;
+        port = (uint16_t)value;
+        p = end;
+    }
+
+    path = *p == '/' ? p : "/";
+    return true;
+}
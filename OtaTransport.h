@@ -0,0 +1,101 @@
+/**
+ * @file OtaTransport.h
+ * @brief HTTP transport interface used by AwsOta for every request it makes
+ * @author Ankan Sarkar
+ * @date 2025
+ * @license MIT
+ *
+ * Backends shipped with the library:
+ *   - OtaHttpClientTransport  Arduino HTTPClient + WiFiClientSecure (default)
+ *   - OtaEspHttpTransport     ESP-IDF esp_http_client with tunable buffers
+ *   - OtaSocketTransport      plain HTTP over BSD sockets (LAN mirrors, host builds)
+ *
+ * @note Has no Arduino dependencies so host tools can build against it.
+ */
+
+#ifndef OTA_TRANSPORT_H
+#define OTA_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ========================================
+// TYPE DEFINITIONS
+// ========================================
+
+// One request header; both strings only need to live for the request() call
+typedef struct {
+    const char* name;
+    const char* value;
+} OtaHeader_t;
+
+class OtaTransport {
+public:
+    virtual ~OtaTransport() {}
+
+    /**
+     * @brief Set trust anchor and timeout; AwsOta calls this before every check
+     * @param rootCa PEM root CA for https:// (ignored by plain HTTP backends)
+     * @param timeoutMs Connect timeout and longest wait for any single read
+     */
+    virtual void configure(const char* rootCa, uint32_t timeoutMs) = 0;
+
+    /**
+     * @brief Can this backend fetch url? AwsOta rejects manifest URLs it can't
+     */
+    virtual bool supports(const char* url) = 0;
+
+    /**
+     * @brief Send a request and read the status line and headers
+     * @param method "GET" or "POST"
+     * @param keepAlive Keep the connection for a following request to the same host
+     * @param body POST body (NULL for none)
+     * @return HTTP status code, negative on a connection error
+     *
+     * Reuses the open connection when the host is unchanged, otherwise
+     * connects (and closes the old one) first.
+     */
+    virtual int request(const char* method, const char* url, const OtaHeader_t* headers, size_t headerCount,
+                        bool keepAlive, const uint8_t* body = NULL, size_t bodyLength = 0) = 0;
+
+    /**
+     * @brief Content-Length of the current response, -1 if unknown (chunked)
+     */
+    virtual int contentLength() = 0;
+
+    /**
+     * @brief ETag of the current response ("" if none)
+     */
+    virtual const char* etag() = 0;
+
+    /**
+     * @brief Read up to length bytes of the (de-chunked) response body
+     * @return Bytes read, 0 at the end of the body, negative on error or timeout
+     */
+    virtual int read(uint8_t* buffer, size_t length) = 0;
+
+    /**
+     * @brief Finish the response; the connection stays open if it can be reused
+     */
+    virtual void end() = 0;
+
+    /**
+     * @brief Close the connection
+     */
+    virtual void stop() = 0;
+
+    /**
+     * @brief Backend name for logs
+     */
+    virtual const char* name() = 0;
+
+protected:
+    /**
+     * @brief Split "scheme://host[:port]/path" (port defaults from the scheme)
+     * @param path Set to the path inside url ("/" if it has none)
+     * @return false if url is not http:// or https:// or the host does not fit
+     */
+    static bool parseUrl(const char* url, char* host, size_t hostSize, uint16_t& port, const char*& path);
+};
+
+#endif // OTA_TRANSPORT_H
@@ -0,0 +1,109 @@
+/**
+ * @file TransportBenchmark.ino
+ * @brief Compare OTA transports side by side on your own network
+ *
+ * This example shows:
+ * - Downloading the same firmware image through each transport (nothing is flashed)
+ * - Time to first byte, throughput and free heap per transport
+ * - Tuning esp_http_client buffer sizes
+ *
+ * Pick the fastest one for your deployment and pass it to ota.setTransport().
+ */
+
+#include <WiFi.h>
+#include <AwsS3Ota.h>
+#include <OtaEspHttpTransport.h>
+#include <OtaSocketTransport.h>
+#include "aws_root_ca.h"
+
+// ===== CONFIGURATION =====
+const char* ssid = "YourWiFiSSID";
+const char* password = "YourWiFiPassword";
+const char* firmwareUrl = "https://your-bucket.s3.amazonaws.com/firmware/yourcompiledbinfile.ino.bin";
+
+// Optional: the same file on a plain-HTTP LAN mirror (leave empty to skip)
+const char* mirrorUrl = "";
+
+#define READ_SIZE 512  // Same chunk size as the update download
+#define RUNS 2
+
+// ===== TRANSPORTS UNDER TEST =====
+OtaHttpClientTransport httpClient;
+OtaEspHttpTransport espDefault;              // 4 KB receive buffer
+OtaEspHttpTransport espLarge(16384, 1024);   // 16 KB receive buffer
+
+void benchmark(OtaTransport& transport, const char* label, const char* url) {
+  static uint8_t buffer[READ_SIZE];
+
+  if (!transport.supports(url)) {
+    Serial.printf("%-22s skipped (URL scheme not supported)\n", label);
+    return;
+  }
+
+  for (int run = 1; run <= RUNS; run++) {
+    transport.configure(AWS_ROOT_CA, 30000);
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t start = millis();
+
+    int status = transport.request("GET", url, NULL, 0, false);
+    uint32_t firstByte = millis() - start;
+    if (status != 200) {
+      Serial.printf("%-22s run %d: HTTP %d\n", label, run, status);
+      transport.stop();
+      continue;
+    }
+
+    uint32_t minHeap = ESP.getFreeHeap();
+    size_t total = 0;
+    int n;
+    while ((n = transport.read(buffer, sizeof(buffer))) > 0) {
+      total += n;
+      if ((total & 0xFFFF) < (size_t)n) {
+        minHeap = min(minHeap, ESP.getFreeHeap());
+      }
+    }
+    uint32_t elapsed = millis() - start;
+    // Before stop() - HTTPClient forgets the length when the connection ends
+    bool complete = n == 0 && (transport.contentLength() < 0 || total == (size_t)transport.contentLength());
+    transport.stop();
+
+    Serial.printf("%-22s run %d: %u bytes, first byte %u ms, %u ms, %.1f KB/s, heap used %u%s\n",
+                  label, run, (unsigned)total, (unsigned)firstByte, (unsigned)elapsed,
+                  elapsed ? total / 1.024 / elapsed : 0.0, (unsigned)(heapBefore - minHeap),
+                  complete ? "" : " (INCOMPLETE)");
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.println("\n\nOTA Transport Benchmark");
+
+  // Connect WiFi
+  Serial.print("Connecting to WiFi...");
+  WiFi.begin(ssid, password);
+
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+  }
+
+  Serial.println("\nWiFi connected!");
+  Serial.printf("IP: %s\n\n", WiFi.localIP().toString().c_str());
+
+  benchmark(httpClient, "HTTPClient", firmwareUrl);
+  benchmark(espDefault, "esp_http_client 4K", firmwareUrl);
+  benchmark(espLarge, "esp_http_client 16K", firmwareUrl);
+
+  if (strlen(mirrorUrl) > 0) {
+    OtaSocketTransport mirror;
+    benchmark(mirror, "socket (LAN mirror)", mirrorUrl);
+  }
+
+  Serial.println("\nDone. Use the winner with ota.setTransport(&transport);");
+}
+
+void loop() {
+  delay(1000);
+}
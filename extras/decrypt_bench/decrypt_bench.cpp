@@ -0,0 +1,180 @@
+/**
+ * @file decrypt_bench.cpp
+ * @brief Host benchmark of the firmware decryption stage (OtaDecrypt)
+ *
+ * Encrypts a random image with mbedtls, then decrypts it through OtaDecrypt
+ * chunk by chunk the way AwsOta::downloadAndFlash does (in place, whole AES
+ * blocks until the last chunk). Each run checks the plaintext and the GCM
+ * tag, makes sure a tampered tag is rejected, and reports the cost per MB.
+ *
+ * Host figures use software AES (AES-NI if mbedtls was built with it). On
+ * the device, AwsOta logs "Decrypted N KB in X ms (Y ms per MB)" for every
+ * encrypted update, measured on the AES hardware accelerator.
+ *
+ * Build:  make   (mbedtls 2.x or 3.x headers + libmbedcrypto, see Makefile)
+ * Run:    ./decrypt_bench --mb 16 --chunk 512
+ */
+
+#include <OtaDecrypt.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Options {
+    size_t imageBytes = 16 * 1024 * 1024;
+    std::vector<size_t> chunks = {512, 4096};  // downloadAndFlash uses 512
+};
+
+static void usage() {
+    printf(
+        "Usage: decrypt_bench [options]\n"
+        "  --mb N       Image size in MB (default 16)\n"
+        "  --chunk N    Chunk size in bytes, repeatable (default 512 and 4096)\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt) {
+    bool chunkGiven = false;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage();
+            exit(0);
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+        double v = atof(argv[++i]);
+
+        if (strcmp(arg, "--mb") == 0) {
+            opt.imageBytes = (size_t)(v * 1024 * 1024);
+        } else if (strcmp(arg, "--chunk") == 0) {
+            if (!chunkGiven) opt.chunks.clear();
+            chunkGiven = true;
+            opt.chunks.push_back((size_t)v);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return false;
+        }
+    }
+    for (size_t chunk : opt.chunks) {
+        if (chunk < OTA_AES_BLOCK_SIZE) return false;
+    }
+    return opt.imageBytes > 0;
+}
+
+// Reference encryption straight through mbedtls
+static bool encryptImage(OtaCipher_t cipher, const uint8_t* key, size_t keyLength, const uint8_t* iv,
+                         size_t ivLength, std::vector<uint8_t>& data, uint8_t* tag) {
+    if (cipher == OTA_CIPHER_AES_CTR) {
+        mbedtls_aes_context aes;
+        mbedtls_aes_init(&aes);
+        uint8_t counter[OTA_AES_BLOCK_SIZE], keystream[OTA_AES_BLOCK_SIZE];
+        size_t offset = 0;
+        memcpy(counter, iv, sizeof(counter));
+        bool ok = mbedtls_aes_setkey_enc(&aes, key, keyLength * 8) == 0 &&
+                  mbedtls_aes_crypt_ctr(&aes, data.size(), &offset, counter, keystream, data.data(), data.data()) == 0;
+        mbedtls_aes_free(&aes);
+        return ok;
+    }
+
+    mbedtls_gcm_context gcm;
+    mbedtls_gcm_init(&gcm);
+    bool ok = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, keyLength * 8) == 0 &&
+              mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, data.size(), iv, ivLength, NULL, 0,
+                                        data.data(), data.data(), OTA_GCM_TAG_SIZE, tag) == 0;
+    mbedtls_gcm_free(&gcm);
+    return ok;
+}
+
+// Same chunking as downloadAndFlash; returns seconds spent in OtaDecrypt, < 0 on failure
+static double decryptImage(OtaCipher_t cipher, const uint8_t* key, size_t keyLength, const uint8_t* iv,
+                           size_t ivLength, const uint8_t* tag, std::vector<uint8_t>& data, size_t chunk) {
+    auto start = std::chrono::steady_clock::now();
+
+    OtaDecrypt decrypt;
+    if (!decrypt.begin(cipher, key, keyLength, iv, ivLength)) return -1;
+
+    size_t done = 0;
+    while (done < data.size()) {
+        size_t n = std::min(chunk, data.size() - done);
+        if (n < data.size() - done) {
+            n -= n % OTA_AES_BLOCK_SIZE;
+        }
+        if (!decrypt.update(data.data() + done, n)) return -1;
+        done += n;
+    }
+    if (!decrypt.finish(tag, OTA_GCM_TAG_SIZE)) return -1;
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    std::mt19937 rng(1);
+    std::vector<uint8_t> plain(opt.imageBytes);
+    for (uint8_t& b : plain) b = (uint8_t)rng();
+
+    uint8_t key[32], iv[OTA_AES_BLOCK_SIZE];
+    for (uint8_t& b : key) b = (uint8_t)rng();
+    for (uint8_t& b : iv) b = (uint8_t)rng();
+
+    const struct {
+        OtaCipher_t cipher;
+        const char* name;
+        size_t ivLength;
+    } ciphers[] = {
+        {OTA_CIPHER_AES_CTR, "aes-ctr", OTA_AES_BLOCK_SIZE},
+        {OTA_CIPHER_AES_GCM, "aes-gcm", 12},
+    };
+    const size_t keyLengths[] = {16, 32};
+
+    printf("Image %.1f MB, decrypted in place\n", opt.imageBytes / 1048576.0);
+    printf("%-8s %4s %6s %10s %9s  %s\n", "cipher", "key", "chunk", "MB/s", "ms/MB", "check");
+
+    bool allOk = true;
+    std::vector<uint8_t> data;
+    for (const auto& c : ciphers) {
+        for (size_t keyLength : keyLengths) {
+            uint8_t tag[OTA_GCM_TAG_SIZE] = {0};
+            std::vector<uint8_t> sealed = plain;
+            if (!encryptImage(c.cipher, key, keyLength, iv, c.ivLength, sealed, tag)) {
+                printf("%-8s %4zu  reference encryption failed\n", c.name, keyLength * 8);
+                allOk = false;
+                continue;
+            }
+
+            for (size_t chunk : opt.chunks) {
+                data = sealed;
+                double seconds = decryptImage(c.cipher, key, keyLength, iv, c.ivLength, tag, data, chunk);
+                bool ok = seconds >= 0 && data == plain;
+
+                // A tampered tag must be rejected (CTR has no tag to check)
+                if (ok && c.cipher == OTA_CIPHER_AES_GCM) {
+                    uint8_t bad[OTA_GCM_TAG_SIZE];
+                    memcpy(bad, tag, sizeof(bad));
+                    bad[0] ^= 1;
+                    data = sealed;
+                    ok = decryptImage(c.cipher, key, keyLength, iv, c.ivLength, bad, data, chunk) < 0;
+                }
+
+                double mb = opt.imageBytes / 1048576.0;
+                printf("%-8s %4zu %6zu %10.1f %9.3f  %s\n", c.name, keyLength * 8, chunk,
+                       seconds > 0 ? mb / seconds : 0.0, seconds > 0 ? seconds * 1000 / mb : 0.0,
+                       ok ? "ok" : "FAIL");
+                allOk = allOk && ok;
+            }
+        }
+    }
+
+    return allOk ? 0 : 1;
+}
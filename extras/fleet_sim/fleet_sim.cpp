@@ -0,0 +1,396 @@
+/**
+ * @file fleet_sim.cpp
+ * @brief Fleet-scale OTA load simulator driven by the real AwsOta code
+ *
+ * Runs thousands of virtual devices, each calling AwsOta::checkNow() on its
+ * poll interval (or, with --push 1, waiting in AwsOta::checkOnPush() for a
+ * broker notification sent at release), against a simulated S3 / API Gateway endpoint with
+ * configurable latency, bandwidth, error rate and throttling. A release is
+ * published part-way through; the report shows request rates, bytes served,
+ * retry amplification and how long the fleet took to converge. Images have
+ * real contents: every flashed byte is checked against the release, and with
+ * --blocks 1 devices hash their running image and fetch only changed blocks.
+ * --fleet 1 replaces the JSON manifest with a binary fleet table (Range
+ * binary search or, with --fleet-range 0, a streaming scan), most of whose
+ * entries point at encrypted images.
+ *
+ * Build:  make ARDUINOJSON_DIR=~/Arduino/libraries/ArduinoJson/src
+ * Run:    ./fleet_sim --devices 2000 --poll-sec 900 --throttle-rps 50
+ *
+ * Exit code is 1 if the fleet did not converge in time (see --max-converge-sec),
+ * flashed a wrong image, fetched too much per update (see --max-fetch-pct) or
+ * made too many requests (see --max-requests), so it can gate poll/retry
+ * changes in CI. "make check" runs a few scenarios.
+ */
+
+#include <AwsS3Ota.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+
+struct Options {
+    int devices = 1000;
+    double durationSec = 4 * 3600;
+    double pollSec = 3600;
+    double jitter = 0.1;          // Poll interval varies by +/- this fraction
+    double bootSec = 10;          // Reboot time after an update
+    int retries = 3;
+    int httpTimeoutSec = 120;
+    bool report = false;
+    bool push = false;
+    double pushSpreadSec = 30;
+    double maxConvergeSec = -1;   // Fail if 100% convergence takes longer
+    double maxFetchPct = -1;      // Fail if updates fetch more than this share of the image
+    double maxRequests = -1;      // Fail if devices make more requests than this on average
+    unsigned seed = 1;
+    int traceDevice = -1;
+    const char* csvPath = nullptr;
+    sim::ServerConfig server;
+};
+
+static void usage() {
+    printf(
+        "Usage: fleet_sim [options]\n"
+        "  --devices N            Virtual devices (default 1000)\n"
+        "  --duration-sec S       Simulated time (default 14400)\n"
+        "  --poll-sec S           Check interval (default 3600)\n"
+        "  --jitter F             Interval jitter, fraction (default 0.1)\n"
+        "  --boot-sec S           Reboot time after update (default 10)\n"
+        "  --release-sec S        When the new version is published (default 60)\n"
+        "  --image-kb N           Firmware size (default 1024)\n"
+        "  --blocks 0|1           Publish a block list for incremental sync (default 0)\n"
+        "  --block-size N         Block list block size in bytes (default 4096)\n"
+        "  --changed-pct P        Blocks that differ between old and new image (default 5)\n"
+        "  --fleet 0|1            AwsOta::setFleetManifest with a binary fleet table (default 0)\n"
+        "  --fleet-variants N     Hardware variants in the table, two channels each (default 40)\n"
+        "  --fleet-range 0|1      Server honours Range for the table; 0 = streaming scan (default 1)\n"
+        "  --fleet-enc 0|1        Encrypt 2 of 3 variants' images, table format 2 (default 1)\n"
+        "  --link-kbps N          Per-device bandwidth, kilobytes/s (default 250)\n"
+        "  --egress-mbps N        Server egress, megabytes/s (default 1000)\n"
+        "  --latency-ms N         Network round trip (default 80)\n"
+        "  --tls-ms N             TLS handshake cost (default 400)\n"
+        "  --error-rate F         Fraction of requests failing with 500 (default 0)\n"
+        "  --drop-rate F          Fraction of downloads cut mid-stream (default 0)\n"
+        "  --throttle-rps N       Server request limit, 503 beyond it (default off)\n"
+        "  --retries N            AwsOta::setMaxRetries (default 3)\n"
+        "  --http-timeout-sec N   AwsOta::setHttpTimeout (default 120)\n"
+        "  --report 0|1           AwsOta::setReportEndpoint on the manifest host (default 0)\n"
+        "  --push 0|1             AwsOta::checkOnPush, --poll-sec becomes the fallback, 0 = none (default 0)\n"
+        "  --push-spread-sec S    Random delay after a push (default 30)\n"
+        "  --max-converge-sec S   Fail unless all devices update within S of release\n"
+        "  --max-fetch-pct P      Fail if bytes served per update exceed P%% of the image\n"
+        "  --max-requests N       Fail if devices make more than N requests each on average\n"
+        "  --seed N               Random seed (default 1)\n"
+        "  --csv FILE             Write per-second traffic to FILE\n"
+        "  --trace ID             Print the OTA log of one device\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage();
+            exit(0);
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+        const char* value = argv[++i];
+        double v = atof(value);
+
+        if (strcmp(arg, "--devices") == 0) opt.devices = (int)v;
+        else if (strcmp(arg, "--duration-sec") == 0) opt.durationSec = v;
+        else if (strcmp(arg, "--poll-sec") == 0) opt.pollSec = v;
+        else if (strcmp(arg, "--jitter") == 0) opt.jitter = v;
+        else if (strcmp(arg, "--boot-sec") == 0) opt.bootSec = v;
+        else if (strcmp(arg, "--release-sec") == 0) opt.server.releaseAtMs = (uint64_t)(v * 1000);
+        else if (strcmp(arg, "--image-kb") == 0) opt.server.imageSize = (size_t)(v * 1024);
+        else if (strcmp(arg, "--blocks") == 0) opt.server.blocks = v != 0;
+        else if (strcmp(arg, "--block-size") == 0) opt.server.blockSize = (uint32_t)v;
+        else if (strcmp(arg, "--changed-pct") == 0) opt.server.changedFraction = v / 100;
+        else if (strcmp(arg, "--fleet") == 0) opt.server.fleet = v != 0;
+        else if (strcmp(arg, "--fleet-variants") == 0) opt.server.fleetVariants = (int)v;
+        else if (strcmp(arg, "--fleet-range") == 0) opt.server.fleetRange = v != 0;
+        else if (strcmp(arg, "--fleet-enc") == 0) opt.server.fleetEncrypt = v != 0;
+        else if (strcmp(arg, "--link-kbps") == 0) opt.server.linkBytesPerSec = v * 1e3;
+        else if (strcmp(arg, "--egress-mbps") == 0) opt.server.egressBytesPerSec = v * 1e6;
+        else if (strcmp(arg, "--latency-ms") == 0) opt.server.latencyMs = v;
+        else if (strcmp(arg, "--tls-ms") == 0) opt.server.tlsHandshakeMs = v;
+        else if (strcmp(arg, "--error-rate") == 0) opt.server.errorRate = v;
+        else if (strcmp(arg, "--drop-rate") == 0) opt.server.dropRate = v;
+        else if (strcmp(arg, "--throttle-rps") == 0) opt.server.throttleRps = v;
+        else if (strcmp(arg, "--retries") == 0) opt.retries = (int)v;
+        else if (strcmp(arg, "--http-timeout-sec") == 0) opt.httpTimeoutSec = (int)v;
+        else if (strcmp(arg, "--report") == 0) opt.report = v != 0;
+        else if (strcmp(arg, "--push") == 0) opt.push = v != 0;
+        else if (strcmp(arg, "--push-spread-sec") == 0) opt.pushSpreadSec = v;
+        else if (strcmp(arg, "--max-converge-sec") == 0) opt.maxConvergeSec = v;
+        else if (strcmp(arg, "--max-fetch-pct") == 0) opt.maxFetchPct = v;
+        else if (strcmp(arg, "--max-requests") == 0) opt.maxRequests = v;
+        else if (strcmp(arg, "--seed") == 0) opt.seed = (unsigned)v;
+        else if (strcmp(arg, "--csv") == 0) opt.csvPath = value;
+        else if (strcmp(arg, "--trace") == 0) opt.traceDevice = (int)v;
+        else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return false;
+        }
+    }
+    return opt.devices > 0 && (opt.pollSec > 0 || (opt.push && opt.pollSec == 0)) && opt.durationSec > 0 && opt.server.imageSize >= 1024 &&
+           opt.server.blockSize > 0 && opt.server.fleetVariants > 0;
+}
+
+static uint64_t jittered(double seconds, double jitter) {
+    std::uniform_real_distribution<double> factor(1.0 - jitter, 1.0 + jitter);
+    return (uint64_t)(seconds * 1000 * factor(sim::rng()));
+}
+
+static const char* kPushTopic = "fleet/ota";
+
+// One virtual device: boot, check, sleep, check... and reboot into new firmware
+static void deviceMain(sim::Device* device, const Options& opt) {
+    sim::bindDevice(device);
+    device->mainTask = sim::currentTask();
+    std::string hardwareId = sim::server().hardwareId(device);
+
+    if (opt.server.fleet) {
+        AwsOta provisioning;  // Once, like a factory sketch
+        provisioning.storeDecryptionKey(sim::Server::kImageKey, sizeof(sim::Server::kImageKey));
+    }
+
+    while (true) {
+        AwsOta ota;
+        ota.setDebug(sim::tracing());
+        ota.setAutoTaskSuspend(false);  // No other tasks on a virtual device
+        ota.setMaxRetries(opt.retries);
+        ota.setHttpTimeout(opt.httpTimeoutSec);
+        if (opt.report) ota.setReportEndpoint(sim::Server::kReportUrl);
+        ota.onStart([device] { device->checks++; });
+        if (opt.server.fleet) {
+            ota.begin(sim::Server::kFleetUrl, device->version.c_str(), "");
+            ota.setFleetManifest(hardwareId.c_str());
+        } else {
+            ota.begin(sim::Server::kManifestUrl, device->version.c_str(), "");
+        }
+
+        try {
+            if (opt.push) {
+                // Checks run in the library's push task; wait for it to restart us
+                ota.checkOnPush(sim::Broker::kUri, kPushTopic, (unsigned long)(opt.pollSec * 1000),
+                                (unsigned long)(opt.pushSpreadSec * 1000));
+                while (!device->restartPending) {
+                    sim::waitNotify(UINT64_MAX);
+                }
+                device->restartPending = false;
+                throw sim::Restart();
+            }
+            while (true) {
+                ota.checkNow();
+                sim::sleepFor(jittered(opt.pollSec, opt.jitter));
+            }
+        } catch (const sim::Restart&) {
+            sim::broker().disconnect(device);
+            device->version = device->flashed;
+            device->updates++;
+            if (device->version == opt.server.targetVersion && device->convergedAtMs < 0) {
+                device->convergedAtMs = (int64_t)sim::nowMs();
+            }
+            sim::sleepFor((uint64_t)(opt.bootSec * 1000));
+        }
+    }
+}
+
+static const char* formatBytes(double bytes, char* out, size_t size) {
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    int unit = 0;
+    while (bytes >= 1024 && unit < 4) {
+        bytes /= 1024;
+        unit++;
+    }
+    snprintf(out, size, "%.1f %s", bytes, units[unit]);
+    return out;
+}
+
+static void writeCsv(const char* path, const std::vector<sim::Bucket>& buckets,
+                     const std::vector<std::unique_ptr<sim::Device>>& devices) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return;
+    }
+
+    // Devices reaching the target, per second
+    std::vector<uint32_t> converged(buckets.size() + 1, 0);
+    for (const auto& device : devices) {
+        if (device->convergedAtMs >= 0) {
+            converged[std::min<size_t>(device->convergedAtMs / 1000, buckets.size())]++;
+        }
+    }
+
+    fprintf(f, "second,manifest_requests,firmware_requests,other_requests,server_errors,throttled,tls_handshakes,bytes_served,devices_on_target\n");
+    uint32_t onTarget = 0;
+    for (size_t s = 0; s < buckets.size(); s++) {
+        const sim::Bucket& b = buckets[s];
+        onTarget += converged[s];
+        fprintf(f, "%zu,%u,%u,%u,%u,%u,%u,%llu,%u\n", s, b.manifestRequests, b.firmwareRequests,
+                b.otherRequests, b.serverErrors, b.throttled, b.handshakes,
+                (unsigned long long)b.bytesServed, onTarget);
+    }
+    fclose(f);
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    sim::rng().seed(opt.seed);
+    sim::server().configure(opt.server);
+    sim::setTraceDevice(opt.traceDevice);
+
+    std::vector<std::unique_ptr<sim::Device>> devices;
+    // Polling devices are spread over one interval; push devices are all subscribed before release
+    double bootWindowMs = opt.server.releaseAtMs * 0.9;
+    if (opt.pollSec > 0) {
+        bootWindowMs = opt.push ? std::min(opt.pollSec * 1000, bootWindowMs) : opt.pollSec * 1000;
+    }
+    std::uniform_real_distribution<double> phase(0.0, bootWindowMs);
+
+    for (int i = 0; i < opt.devices; i++) {
+        devices.emplace_back(new sim::Device);
+        sim::Device* device = devices.back().get();
+        device->id = i;
+        device->version = opt.server.baseVersion;
+        sim::spawn([device, &opt] { deviceMain(device, opt); }, (uint64_t)phase(sim::rng()));
+    }
+
+    if (opt.push) {
+        sim::spawn([] { sim::broker().publish(kPushTopic); }, opt.server.releaseAtMs);
+    }
+
+    uint64_t endMs = (uint64_t)(opt.durationSec * 1000);
+    sim::runUntil(endMs);
+    sim::shutdown();
+
+    // ---- Aggregate ----
+    const std::vector<sim::Bucket>& buckets = sim::server().buckets();
+    uint64_t manifest = 0, firmware = 0, other = 0, errors = 0, throttled = 0, handshakes = 0, bytes = 0;
+    uint64_t blockLists = 0, ranges = 0;
+    uint32_t peakRate = 0;
+    size_t peakSecond = 0;
+    for (size_t s = 0; s < buckets.size(); s++) {
+        const sim::Bucket& b = buckets[s];
+        manifest += b.manifestRequests;
+        firmware += b.firmwareRequests;
+        other += b.otherRequests;
+        errors += b.serverErrors;
+        throttled += b.throttled;
+        handshakes += b.handshakes;
+        bytes += b.bytesServed;
+        blockLists += b.blockListRequests;
+        ranges += b.rangeRequests;
+        uint32_t rate = b.manifestRequests + b.firmwareRequests + b.otherRequests;
+        if (rate > peakRate) {
+            peakRate = rate;
+            peakSecond = s;
+        }
+    }
+
+    uint64_t checks = 0, updates = 0, badFlashes = 0, wrongEntries = 0;
+    std::vector<int64_t> convergedMs;
+    for (const auto& device : devices) {
+        checks += device->checks;
+        updates += device->updates;
+        badFlashes += device->badFlashes;
+        wrongEntries += device->wrongEntries;
+        if (device->convergedAtMs >= 0) {
+            convergedMs.push_back(device->convergedAtMs - (int64_t)opt.server.releaseAtMs);
+        }
+    }
+    std::sort(convergedMs.begin(), convergedMs.end());
+
+    // ---- Report ----
+    char buf1[32], buf2[32], buf3[32];
+    double requests = manifest + firmware + other;
+    printf("Fleet: %d devices, poll %.0f s (+/-%.0f%%), image %s, release at %.0f s, %.0f s simulated\n",
+           opt.devices, opt.pollSec, opt.jitter * 100, formatBytes(opt.server.imageSize, buf1, sizeof(buf1)),
+           opt.server.releaseAtMs / 1000.0, opt.durationSec);
+    printf("Requests: %.0f (manifest %llu, firmware %llu, other %llu), TLS handshakes %llu\n",
+           requests, (unsigned long long)manifest, (unsigned long long)firmware,
+           (unsigned long long)other, (unsigned long long)handshakes);
+    if (opt.push) {
+        printf("Push: %llu MQTT connections, %llu notifications delivered, spread %.0f s\n",
+               (unsigned long long)sim::broker().connections, (unsigned long long)sim::broker().delivered,
+               opt.pushSpreadSec);
+    }
+    printf("Failures: %llu server errors, %llu throttled\n",
+           (unsigned long long)errors, (unsigned long long)throttled);
+    printf("Bytes served: %s (%s per updated device)\n", formatBytes(bytes, buf1, sizeof(buf1)),
+           formatBytes(updates ? (double)bytes / updates : 0, buf2, sizeof(buf2)));
+    double fetchPct = updates ? 100.0 * bytes / updates / opt.server.imageSize : 0;
+    if (opt.server.blocks) {
+        printf("Incremental sync: %llu block lists, %llu range requests, %s fetched per update (%.1f%% of the image)\n",
+               (unsigned long long)blockLists, (unsigned long long)ranges,
+               formatBytes(updates ? (double)bytes / updates : 0, buf3, sizeof(buf3)), fetchPct);
+    }
+    if (opt.server.fleet) {
+        printf("Fleet table: %d variants x 2 channels, format %d, %s; %llu downloads from another device's entry\n",
+               opt.server.fleetVariants, opt.server.fleetEncrypt ? 2 : 1,
+               opt.server.fleetRange ? "Range lookups" : "streaming scan", (unsigned long long)wrongEntries);
+    }
+    printf("Flash check: %llu of %llu installed images match the release byte for byte\n",
+           (unsigned long long)(updates - std::min(updates, badFlashes)), (unsigned long long)updates);
+    printf("Request rate: mean %.2f/s, peak %u/s at t=%zu s\n",
+           requests / opt.durationSec, peakRate, peakSecond);
+    printf("Retry amplification: %.2f manifest requests per check, %.2f firmware requests per update\n",
+           checks ? (double)manifest / checks : 0.0, updates ? (double)firmware / updates : 0.0);
+
+    int total = opt.devices;
+    auto percentile = [&](double p) -> double {
+        size_t needed = (size_t)(p * total + 0.999);
+        if (needed == 0 || convergedMs.size() < needed) return -1;
+        return convergedMs[needed - 1] / 1000.0;
+    };
+    double t50 = percentile(0.5), t90 = percentile(0.9), t100 = percentile(1.0);
+    printf("Convergence after release: 50%% %s, 90%% %s, 100%% %s (%zu/%d on %s)\n",
+           t50 < 0 ? "-" : (snprintf(buf1, sizeof(buf1), "%.0f s", t50), buf1),
+           t90 < 0 ? "-" : (snprintf(buf2, sizeof(buf2), "%.0f s", t90), buf2),
+           t100 < 0 ? "not reached" : (snprintf(buf3, sizeof(buf3), "%.0f s", t100), buf3),
+           convergedMs.size(), total, opt.server.targetVersion.c_str());
+
+    if (opt.csvPath) {
+        writeCsv(opt.csvPath, buckets, devices);
+    }
+
+    int status = 0;
+    if (t100 < 0 || (opt.maxConvergeSec >= 0 && t100 > opt.maxConvergeSec)) {
+        printf("FAIL: fleet did not converge%s\n", opt.maxConvergeSec >= 0 ? " within --max-converge-sec" : "");
+        status = 1;
+    }
+    if (wrongEntries > 0) {
+        printf("FAIL: %llu firmware downloads used another device's fleet entry\n", (unsigned long long)wrongEntries);
+        status = 1;
+    }
+    if (badFlashes > 0) {
+        printf("FAIL: %llu installed images differ from the release\n", (unsigned long long)badFlashes);
+        status = 1;
+    }
+    if (opt.maxRequests >= 0 && requests / opt.devices > opt.maxRequests) {
+        printf("FAIL: %.1f requests per device, over --max-requests\n", requests / opt.devices);
+        status = 1;
+    }
+    if (opt.maxFetchPct >= 0 && fetchPct > opt.maxFetchPct) {
+        printf("FAIL: %.1f%% of the image fetched per update, over --max-fetch-pct\n", fetchPct);
+        status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the parts of the Arduino core AwsOta uses
+ *
+ * Time comes from the simulator clock, delay() yields to other devices and
+ * Serial output is only printed for the traced device.
+ */
+
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define RTC_DATA_ATTR
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s ? s : "") {}
+    String(const std::string& s) : std::string(s) {}
+};
+
+class Stream {
+public:
+    virtual ~Stream() {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual size_t readBytes(uint8_t* buffer, size_t length) = 0;
+    size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+};
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    void print(const char* text);
+    void println(const char* text);
+    void printf(const char* format, ...);
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    void restart();  // Throws sim::Restart
+    uint32_t getFreeHeap() { return 200 * 1024; }
+};
+
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+long random(long howbig);
+void delay(unsigned long ms);
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,62 @@
+/**
+ * @file HTTPClient.h
+ * @brief Host stand-in for the ESP32 HTTPClient, backed by sim::Server
+ */
+
+#ifndef SIM_HTTP_CLIENT_H
+#define SIM_HTTP_CLIENT_H
+
+#include <WiFi.h>
+#include "sim.h"
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_NO_CONTENT 204
+#define HTTP_CODE_PARTIAL_CONTENT 206
+#define HTTP_CODE_NOT_MODIFIED 304
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+typedef enum {
+    HTTPC_DISABLE_FOLLOW_REDIRECTS,
+    HTTPC_STRICT_FOLLOW_REDIRECTS,
+    HTTPC_FORCE_FOLLOW_REDIRECTS
+} followRedirects_t;
+
+class HTTPClient {
+public:
+    bool begin(WiFiClient& client, const String& url);
+    bool setURL(const String& url);
+    void end();
+
+    void setTimeout(uint16_t) {}
+    void setConnectTimeout(int32_t) {}
+    void setFollowRedirects(followRedirects_t) {}
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void addHeader(const String& name, const String& value);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {}
+
+    int GET();
+    int POST(uint8_t* payload, size_t size);
+    int sendRequest(const char* type, uint8_t* payload = NULL, size_t size = 0);
+    int POST(const String& payload) { return POST((uint8_t*)payload.c_str(), payload.length()); }
+
+    int getSize();
+    String getString();
+    String header(const char* name);
+    bool hasHeader(const char* name) { return header(name).length() > 0; }
+    WiFiClient* getStreamPtr() { return _client; }
+    WiFiClient& getStream() { return *_client; }
+    bool connected() { return _client && (_client->available() > 0 || _client->connected()); }
+
+private:
+    void parseUrl(const String& url);
+
+    WiFiClient* _client = nullptr;
+    bool _reuse = true;  // Same default as the ESP32 core
+    std::string _url;
+    std::string _host;
+    sim::Request _request;
+    sim::Response _response;
+};
+
+#endif // SIM_HTTP_CLIENT_H
@@ -0,0 +1,32 @@
+/**
+ * @file Preferences.h
+ * @brief Host stand-in for the ESP32 Preferences (NVS) library
+ *
+ * Blobs live in the running device's sim::Device::nvs, so they survive a
+ * simulated restart like real NVS does.
+ */
+
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false, const char* partitionLabel = nullptr);
+    void end() { _open = false; }
+
+    size_t putBytes(const char* key, const void* value, size_t length);
+    size_t getBytes(const char* key, void* buffer, size_t maxLength);
+    size_t getBytesLength(const char* key);
+    bool remove(const char* key);
+
+private:
+    std::string path(const char* key) const { return _namespace + "/" + key; }
+
+    std::string _namespace;
+    bool _readOnly = false;
+    bool _open = false;
+};
+
+#endif // SIM_PREFERENCES_H
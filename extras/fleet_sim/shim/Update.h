@@ -0,0 +1,22 @@
+/**
+ * @file Update.h
+ * @brief Host stand-in - records what the current virtual device flashed
+ */
+
+#ifndef SIM_UPDATE_H
+#define SIM_UPDATE_H
+
+#include <Arduino.h>
+
+class UpdateClass {
+public:
+    bool begin(size_t size);
+    size_t write(uint8_t* data, size_t length);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+    uint8_t getError() { return 0; }
+};
+
+extern UpdateClass Update;
+
+#endif // SIM_UPDATE_H
@@ -0,0 +1,66 @@
+/**
+ * @file WiFi.h
+ * @brief Host stand-in for the ESP32 WiFi and WiFiClient API
+ *
+ * A WiFiClient is one simulated connection. Response bodies "arrive" at the
+ * bandwidth the simulated server grants, so reads block in simulated time.
+ */
+
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+#define WL_CONNECTED 3
+
+namespace sim { struct Response; }
+
+class WiFiClass {
+public:
+    int status() { return WL_CONNECTED; }
+    uint8_t* macAddress(uint8_t* mac);  // Derived from the device id
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Stream {
+public:
+    virtual ~WiFiClient();
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t length);  // What has arrived, -1 if nothing
+    size_t readBytes(uint8_t* buffer, size_t length) override;
+    using Stream::readBytes;
+
+    int connected();
+    void stop();
+    void setTimeout(int seconds) { _timeoutMs = seconds * 1000UL; }
+
+    // ---- Simulator side (used by HTTPClient) ----
+    bool isOpenTo(const std::string& host) const { return _open && _host == host; }
+    void open(const std::string& host);
+    void startBody(const sim::Response& response);
+    bool bodyDone();  // Whole body consumed - connection reusable
+
+private:
+    void advance();
+
+    bool _open = false;
+    std::string _host;
+    unsigned long _timeoutMs = 30000;
+
+    std::string _body;           // Small bodies; zero-filled past their end
+    const std::vector<uint8_t>* _data = nullptr;  // Firmware image, if the body is one
+    uint64_t _dataOffset = 0;
+    uint64_t _bodySize = 0;
+    uint64_t _limit = 0;         // Bytes that will ever arrive (< _bodySize if dropped)
+    double _arrived = 0;
+    uint64_t _consumed = 0;
+    uint64_t _lastMs = 0;
+    bool _streaming = false;     // Counted as an active stream on the server
+};
+
+#endif // SIM_WIFI_H
@@ -0,0 +1,19 @@
+/**
+ * @file WiFiClientSecure.h
+ * @brief Host stand-in - TLS cost is modelled by HTTPClient when connecting
+ */
+
+#ifndef SIM_WIFI_CLIENT_SECURE_H
+#define SIM_WIFI_CLIENT_SECURE_H
+
+#include <WiFi.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setCACert(const char*) {}
+    void setCertificate(const char*) {}
+    void setPrivateKey(const char*) {}
+    void setInsecure() {}
+};
+
+#endif // SIM_WIFI_CLIENT_SECURE_H
@@ -0,0 +1,13 @@
+/**
+ * @file esp_idf_version.h
+ * @brief Host stand-in - the shims follow the ESP-IDF 5 API
+ */
+
+#ifndef SIM_ESP_IDF_VERSION_H
+#define SIM_ESP_IDF_VERSION_H
+
+#define ESP_IDF_VERSION_MAJOR 5
+#define ESP_IDF_VERSION_MINOR 1
+#define ESP_IDF_VERSION_PATCH 0
+
+#endif // SIM_ESP_IDF_VERSION_H
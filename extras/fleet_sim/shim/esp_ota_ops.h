@@ -0,0 +1,14 @@
+/**
+ * @file esp_ota_ops.h
+ * @brief Host stand-in
+ */
+
+#ifndef SIM_ESP_OTA_OPS_H
+#define SIM_ESP_OTA_OPS_H
+
+#include <esp_partition.h>
+
+const esp_partition_t* esp_ota_get_running_partition();
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* startFrom);
+
+#endif // SIM_ESP_OTA_OPS_H
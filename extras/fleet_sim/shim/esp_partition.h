@@ -0,0 +1,25 @@
+/**
+ * @file esp_partition.h
+ * @brief Host stand-in - the running partition holds the image of the
+ *        version the virtual device runs
+ */
+
+#ifndef SIM_ESP_PARTITION_H
+#define SIM_ESP_PARTITION_H
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef struct {
+    uint32_t address;
+    uint32_t size;
+    const char* label;
+} esp_partition_t;
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t srcOffset, void* dst, size_t size);
+
+#endif // SIM_ESP_PARTITION_H
@@ -0,0 +1,28 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in - one tick is one simulated millisecond
+ */
+
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <cstddef>
+#include <cstdint>
+
+typedef void* TaskHandle_t;
+typedef unsigned int UBaseType_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+void* pvPortMalloc(size_t size);
+void vPortFree(void* ptr);
+
+#endif // SIM_FREERTOS_H
@@ -0,0 +1,23 @@
+/**
+ * @file aes.h
+ * @brief Host stand-in - a toy block cipher (see shim.cpp) with the real
+ *        CTR counter handling, so a wrong key or IV still breaks the image
+ */
+
+#ifndef SIM_MBEDTLS_AES_H
+#define SIM_MBEDTLS_AES_H
+
+#include <cstddef>
+
+typedef struct {
+    unsigned char key[32];
+    unsigned int keyBytes;
+} mbedtls_aes_context;
+
+void mbedtls_aes_init(mbedtls_aes_context* ctx);
+void mbedtls_aes_free(mbedtls_aes_context* ctx);
+int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits);
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+                          unsigned char stream_block[16], const unsigned char* input, unsigned char* output);
+
+#endif // SIM_MBEDTLS_AES_H
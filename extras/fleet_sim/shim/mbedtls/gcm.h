@@ -0,0 +1,43 @@
+/**
+ * @file gcm.h
+ * @brief Host stand-in (mbedtls 3 API) - the toy block cipher of aes.h in
+ *        GCM's counter layout, with a hash of the ciphertext as the tag
+ */
+
+#ifndef SIM_MBEDTLS_GCM_H
+#define SIM_MBEDTLS_GCM_H
+
+#include <cstddef>
+#include <mbedtls/sha256.h>
+#include <mbedtls/version.h>
+
+typedef enum {
+    MBEDTLS_CIPHER_ID_NONE,
+    MBEDTLS_CIPHER_ID_NULL,
+    MBEDTLS_CIPHER_ID_AES
+} mbedtls_cipher_id_t;
+
+#define MBEDTLS_GCM_ENCRYPT 1
+#define MBEDTLS_GCM_DECRYPT 0
+
+typedef struct {
+    unsigned char key[32];
+    unsigned int keyBytes;
+    int mode;
+    unsigned char counter[16];
+    unsigned char stream[16];
+    size_t streamOffset;
+    mbedtls_sha256_context tag;  // Key, J0 and ciphertext
+} mbedtls_gcm_context;
+
+void mbedtls_gcm_init(mbedtls_gcm_context* ctx);
+void mbedtls_gcm_free(mbedtls_gcm_context* ctx);
+int mbedtls_gcm_setkey(mbedtls_gcm_context* ctx, mbedtls_cipher_id_t cipher, const unsigned char* key,
+                       unsigned int keybits);
+int mbedtls_gcm_starts(mbedtls_gcm_context* ctx, int mode, const unsigned char* iv, size_t iv_len);
+int mbedtls_gcm_update(mbedtls_gcm_context* ctx, const unsigned char* input, size_t input_length,
+                       unsigned char* output, size_t output_size, size_t* output_length);
+int mbedtls_gcm_finish(mbedtls_gcm_context* ctx, unsigned char* output, size_t output_size,
+                       size_t* output_length, unsigned char* tag, size_t tag_len);
+
+#endif // SIM_MBEDTLS_GCM_H
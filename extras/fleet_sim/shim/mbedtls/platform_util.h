@@ -0,0 +1,16 @@
+/**
+ * @file platform_util.h
+ * @brief Host stand-in
+ */
+
+#ifndef SIM_MBEDTLS_PLATFORM_UTIL_H
+#define SIM_MBEDTLS_PLATFORM_UTIL_H
+
+#include <cstddef>
+#include <cstring>
+
+inline void mbedtls_platform_zeroize(void* buffer, size_t length) {
+    memset(buffer, 0, length);
+}
+
+#endif // SIM_MBEDTLS_PLATFORM_UTIL_H
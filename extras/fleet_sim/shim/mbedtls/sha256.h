@@ -0,0 +1,26 @@
+/**
+ * @file sha256.h
+ * @brief Host stand-in - a plain SHA-256, so simulated block hashes match
+ *        the block lists the simulated server publishes
+ */
+
+#ifndef SIM_MBEDTLS_SHA256_H
+#define SIM_MBEDTLS_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;        // Bytes hashed so far
+    unsigned char block[64];
+    size_t used;            // Bytes waiting in block
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx);
+inline void mbedtls_sha256_free(mbedtls_sha256_context*) {}
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224);  // SHA-256 only
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t length);
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]);
+
+#endif // SIM_MBEDTLS_SHA256_H
@@ -0,0 +1,11 @@
+/**
+ * @file version.h
+ * @brief Host stand-in - the shims follow the mbedtls 3 API
+ */
+
+#ifndef SIM_MBEDTLS_VERSION_H
+#define SIM_MBEDTLS_VERSION_H
+
+#define MBEDTLS_VERSION_MAJOR 3
+
+#endif // SIM_MBEDTLS_VERSION_H
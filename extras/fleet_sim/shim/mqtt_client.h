@@ -0,0 +1,74 @@
+/**
+ * @file mqtt_client.h
+ * @brief Host stand-in for the ESP-IDF 5 MQTT client, backed by sim::Broker
+ *
+ * Connecting costs one round trip plus a TLS handshake, then the client
+ * reports MQTT_EVENT_CONNECTED from its own task like the real one.
+ */
+
+#ifndef SIM_MQTT_CLIENT_H
+#define SIM_MQTT_CLIENT_H
+
+#include <cstdint>
+#include <esp_partition.h>  // esp_err_t
+
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* handlerArgs, esp_event_base_t base, int32_t eventId, void* eventData);
+
+#define ESP_EVENT_ANY_ID -1
+
+typedef struct esp_mqtt_client* esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+    MQTT_EVENT_BEFORE_CONNECT,
+    MQTT_EVENT_DELETED
+} esp_mqtt_event_id_t;
+
+typedef struct {
+    esp_mqtt_event_id_t event_id;
+    esp_mqtt_client_handle_t client;
+    char* data;
+    int data_len;
+    int total_data_len;
+    int current_data_offset;
+    char* topic;
+    int topic_len;
+    int msg_id;
+    int session_present;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t* esp_mqtt_event_handle_t;
+
+typedef struct {
+    struct {
+        struct { const char* uri; } address;
+        struct { const char* certificate; } verification;
+    } broker;
+    struct {
+        const char* client_id;
+        struct {
+            const char* certificate;
+            const char* key;
+        } authentication;
+    } credentials;
+    struct {
+        bool disable_clean_session;
+        int keepalive;
+    } session;
+} esp_mqtt_client_config_t;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* config);
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void* handlerArgs);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char* topic, int qos);
+
+#endif // SIM_MQTT_CLIENT_H
@@ -0,0 +1,741 @@
+/**
+ * @file shim.cpp
+ * @brief Host implementations of the Arduino / ESP-IDF calls AwsOta makes
+ */
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <Update.h>
+#include <WiFi.h>
+#include <esp_ota_ops.h>
+#include <mqtt_client.h>
+#include <mbedtls/aes.h>
+#include <mbedtls/gcm.h>
+#include <mbedtls/sha256.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <cmath>
+#include <strings.h>
+
+#include "sim.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+UpdateClass Update;
+
+// ========================================
+// ARDUINO CORE
+// ========================================
+
+unsigned long millis() {
+    return (unsigned long)sim::nowMs();
+}
+
+unsigned long micros() {
+    return (unsigned long)(sim::nowMs() * 1000);
+}
+
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    std::uniform_int_distribution<long> value(0, howbig - 1);
+    return value(sim::rng());
+}
+
+void delay(unsigned long ms) {
+    sim::sleepFor(ms);
+}
+
+void EspClass::restart() {
+    throw sim::Restart();
+}
+
+static bool s_lineStart = true;
+
+void HardwareSerial::print(const char* text) {
+    if (sim::serialSink()) {
+        sim::serialSink()(text);
+        return;
+    }
+    if (!sim::tracing()) return;
+    if (s_lineStart) {
+        printf("[%10.3f s] ", sim::nowMs() / 1000.0);
+    }
+    fputs(text, stdout);
+    s_lineStart = text[0] && text[strlen(text) - 1] == '\n';
+}
+
+void HardwareSerial::println(const char* text) {
+    print(text);
+    print("\n");
+}
+
+void HardwareSerial::printf(const char* format, ...) {
+    if (!sim::tracing()) return;
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+// ========================================
+// FREERTOS
+// ========================================
+
+void* pvPortMalloc(size_t size) {
+    return malloc(size);
+}
+
+void vPortFree(void* ptr) {
+    free(ptr);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char*, uint32_t, void* parameters, UBaseType_t, TaskHandle_t* handle) {
+    if (!sim::currentDevice()) return pdFAIL;
+    TaskHandle_t created = sim::spawnTask([task, parameters] { task(parameters); });
+    if (handle) *handle = created;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == sim::currentTask()) {
+        throw sim::TaskExit();
+    }
+    // Deleting another task is not needed by the library
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sim::sleepFor(ticks);
+}
+
+void vTaskSuspend(TaskHandle_t) {}
+void vTaskResume(TaskHandle_t) {}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return sim::currentTask();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    uint64_t timeoutMs = ticksToWait == portMAX_DELAY ? UINT64_MAX : ticksToWait;
+    uint32_t count = sim::waitNotify(timeoutMs);
+    if (!clearCountOnExit && count > 1) {
+        // Decrement semantics: put the rest back
+        for (uint32_t i = 1; i < count; i++) sim::notify(sim::currentTask());
+        count = 1;
+    }
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    sim::notify(task);
+    return pdPASS;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks() {
+    return 0;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t*, UBaseType_t, uint32_t*) {
+    return 0;
+}
+
+// ========================================
+// FLASH
+// ========================================
+
+static esp_partition_t s_running = {0x10000, 0, "app0"};
+static esp_partition_t s_next = {0x200000, 0, "app1"};
+
+const esp_partition_t* esp_ota_get_running_partition() {
+    s_running.size = sim::server().partitionSize();
+    return &s_running;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) {
+    s_next.size = sim::server().partitionSize();
+    return &s_next;
+}
+
+// The running partition holds the image of the version the device runs,
+// erased flash (0xFF) after it
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t srcOffset, void* dst, size_t size) {
+    sim::Device* device = sim::currentDevice();
+    if (!device || partition != &s_running || srcOffset + size > partition->size) return ESP_FAIL;
+
+    const std::vector<uint8_t>& image = sim::server().image(device->version);
+    size_t n = srcOffset < image.size() ? std::min(size, image.size() - srcOffset) : 0;
+    memcpy(dst, image.data() + srcOffset, n);
+    memset((uint8_t*)dst + n, 0xFF, size - n);
+    return ESP_OK;
+}
+
+bool UpdateClass::begin(size_t size) {
+    sim::Device* device = sim::currentDevice();
+    if (!device || size == 0 || size > sim::server().partitionSize()) return false;
+    device->updateSize = size;
+    device->updateWritten = 0;
+    device->updateCorrupt = false;
+    return true;
+}
+
+// Every byte is checked against the release image being installed
+size_t UpdateClass::write(uint8_t* data, size_t length) {
+    sim::Device* device = sim::currentDevice();
+    if (!device || device->updateWritten + length > device->updateSize) return 0;
+    const std::vector<uint8_t>& image = sim::server().image(device->downloading);
+    if (device->updateWritten + length > image.size() ||
+        memcmp(data, image.data() + device->updateWritten, length) != 0) {
+        device->updateCorrupt = true;
+    }
+    device->updateWritten += length;
+    return length;
+}
+
+bool UpdateClass::end(bool) {
+    sim::Device* device = sim::currentDevice();
+    if (!device || device->updateSize == 0 || device->updateWritten != device->updateSize) return false;
+    if (device->updateCorrupt || device->updateSize != sim::server().image(device->downloading).size()) {
+        device->badFlashes++;
+    }
+    device->flashed = device->downloading;
+    device->updateSize = 0;
+    return true;
+}
+
+void UpdateClass::abort() {
+    sim::Device* device = sim::currentDevice();
+    if (device) device->updateSize = 0;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char*) {
+    if (!sim::currentDevice()) return false;
+    _namespace = name;
+    _readOnly = readOnly;
+    _open = true;
+    return true;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (!_open || _readOnly) return 0;
+    sim::currentDevice()->nvs[path(key)].assign((const char*)value, length);
+    return length;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    if (!_open) return 0;
+    auto& nvs = sim::currentDevice()->nvs;
+    auto it = nvs.find(path(key));
+    if (it == nvs.end() || it->second.size() > maxLength) return 0;
+    memcpy(buffer, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!_open) return 0;
+    auto& nvs = sim::currentDevice()->nvs;
+    auto it = nvs.find(path(key));
+    return it == nvs.end() ? 0 : it->second.size();
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_open || _readOnly) return false;
+    return sim::currentDevice()->nvs.erase(path(key)) > 0;
+}
+
+// ========================================
+// MQTT
+// ========================================
+
+struct esp_mqtt_client {
+    esp_event_handler_t handler = nullptr;
+    void* handlerArgs = nullptr;
+};
+
+static void mqttEvent(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t id, const std::string& topic = "") {
+    if (!client->handler) return;
+    esp_mqtt_event_t event = {};
+    event.event_id = id;
+    event.client = client;
+    event.topic = (char*)topic.c_str();
+    event.topic_len = (int)topic.size();
+    event.data = (char*)"";
+    client->handler(client->handlerArgs, "MQTT_EVENTS", id, &event);
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t*) {
+    return sim::currentDevice() ? new esp_mqtt_client : nullptr;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t,
+                                         esp_event_handler_t handler, void* handlerArgs) {
+    client->handler = handler;
+    client->handlerArgs = handlerArgs;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) {
+    // Connect from a task of its own, like the ESP-IDF MQTT task
+    sim::spawnTask([client] {
+        const sim::ServerConfig& config = sim::server().config();
+        sim::sleepFor((uint64_t)(config.latencyMs + config.tlsHandshakeMs));
+        sim::server().countHandshake();
+        sim::broker().connections++;
+        mqttEvent(client, MQTT_EVENT_CONNECTED);
+    });
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char* topic, int) {
+    sim::broker().subscribe(topic, [client](const std::string& t) { mqttEvent(client, MQTT_EVENT_DATA, t); });
+    return 1;
+}
+
+// ========================================
+// NETWORK - CONNECTION
+// ========================================
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+    sim::Device* device = sim::currentDevice();
+    int id = device ? device->id : 0;
+    const uint8_t address[6] = {0x02, 0x00, 0x00, (uint8_t)(id >> 16), (uint8_t)(id >> 8), (uint8_t)id};
+    memcpy(mac, address, sizeof(address));
+    return mac;
+}
+
+WiFiClient::~WiFiClient() {
+    stop();
+}
+
+void WiFiClient::open(const std::string& host) {
+    stop();
+    _open = true;
+    _host = host;
+}
+
+void WiFiClient::stop() {
+    if (_streaming) {
+        sim::server().streamClosed();
+        _streaming = false;
+    }
+    _open = false;
+    _body.clear();
+    _data = nullptr;
+    _bodySize = _limit = _consumed = 0;
+    _arrived = 0;
+}
+
+int WiFiClient::connected() {
+    return _open;
+}
+
+void WiFiClient::startBody(const sim::Response& response) {
+    if (_streaming) {
+        sim::server().streamClosed();
+    }
+    _body = response.body;
+    _data = response.data;
+    _dataOffset = response.dataOffset;
+    _bodySize = response.bodySize;
+    _limit = std::min<uint64_t>(response.bodySize, response.dropAfter);
+    _arrived = 0;
+    _consumed = 0;
+    _lastMs = sim::nowMs();
+    _streaming = _limit > 0;
+    if (_streaming) {
+        sim::server().streamOpened();
+    } else if (_limit < _bodySize) {
+        _open = false;  // Dropped before the first byte
+    }
+}
+
+bool WiFiClient::bodyDone() {
+    return _open && _consumed >= _bodySize;
+}
+
+// Let bytes arrive for the simulated time that passed since the last look
+void WiFiClient::advance() {
+    if (!_streaming) return;
+
+    uint64_t now = sim::nowMs();
+    double before = _arrived;
+    _arrived = std::min<double>(_limit, _arrived + sim::server().streamBytesPerSec() * (now - _lastMs) / 1000.0);
+    _lastMs = now;
+    sim::server().countBytes((uint64_t)_arrived - (uint64_t)before);
+
+    if ((uint64_t)_arrived >= _limit) {
+        sim::server().streamClosed();
+        _streaming = false;
+        if (_limit < _bodySize) {
+            _open = false;  // Peer dropped the connection mid-body
+        }
+    }
+}
+
+int WiFiClient::available() {
+    advance();
+    return (int)((uint64_t)_arrived - _consumed);
+}
+
+int WiFiClient::read() {
+    uint8_t byte;
+    return readBytes(&byte, 1) == 1 ? byte : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t length) {
+    size_t ready = (size_t)std::max(0, available());
+    return ready ? (int)readBytes(buffer, std::min(ready, length)) : -1;
+}
+
+size_t WiFiClient::readBytes(uint8_t* buffer, size_t length) {
+    size_t got = 0;
+    uint64_t deadline = sim::nowMs() + _timeoutMs;
+
+    while (got < length) {
+        size_t ready = (size_t)available();
+        if (ready > 0) {
+            size_t n = std::min(ready, length - got);
+            if (_data) {
+                memcpy(buffer + got, _data->data() + _dataOffset + _consumed, n);  // Firmware image
+            } else {
+                size_t real = _consumed < _body.size() ? std::min<size_t>(n, _body.size() - _consumed) : 0;
+                memcpy(buffer + got, _body.data() + _consumed, real);
+                memset(buffer + got + real, 0, n - real);
+            }
+            _consumed += n;
+            got += n;
+            continue;
+        }
+
+        if (!_streaming || sim::nowMs() >= deadline) break;
+
+        // Sleep until the missing bytes should have arrived
+        double rate = std::max(1.0, sim::server().streamBytesPerSec());
+        uint64_t waitMs = (uint64_t)std::ceil((length - got) * 1000.0 / rate);
+        sim::sleepFor(std::max<uint64_t>(1, std::min(waitMs, deadline - sim::nowMs())));
+    }
+    return got;
+}
+
+// ========================================
+// NETWORK - HTTP
+// ========================================
+
+// Like the ESP32 core: begin() while a kept-alive client is still attached
+// drops that connection, only setURL() carries it over to the next request.
+bool HTTPClient::begin(WiFiClient& client, const String& url) {
+    if (_client) {
+        _client->stop();
+    }
+    _client = &client;
+    _request = sim::Request();
+    parseUrl(url);
+    return true;
+}
+
+bool HTTPClient::setURL(const String& url) {
+    if (!_client || url.compare(0, _url.find("://"), _url, 0, _url.find("://")) != 0) {
+        return false;  // Protocol change
+    }
+    parseUrl(url);
+    return true;
+}
+
+void HTTPClient::parseUrl(const String& url) {
+    _url = url;
+    size_t hostStart = _url.find("://");
+    hostStart = hostStart == std::string::npos ? 0 : hostStart + 3;
+    _host = _url.substr(hostStart, _url.find('/', hostStart) - hostStart);
+}
+
+void HTTPClient::end() {
+    if (_client && (!_reuse || !_client->bodyDone())) {
+        _client->stop();
+        _client = nullptr;
+    }
+    _request = sim::Request();
+}
+
+void HTTPClient::addHeader(const String& name, const String& value) {
+    if (name == "Range") {
+        unsigned long long start = 0, end = 0;
+        if (sscanf(value.c_str(), "bytes=%llu-%llu", &start, &end) == 2) {
+            _request.hasRange = true;
+            _request.rangeStart = start;
+            _request.rangeEnd = end;
+        }
+    } else if (name == "If-None-Match") {
+        _request.ifNoneMatch = value;
+    }
+}
+
+int HTTPClient::GET() {
+    return sendRequest("GET");
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t size) {
+    return sendRequest("POST", payload, size);
+}
+
+int HTTPClient::sendRequest(const char* method, uint8_t*, size_t bodySize) {
+    if (!_client) return -1;
+
+    const sim::ServerConfig& config = sim::server().config();
+
+    // A kept-alive connection to the same host skips TCP + TLS setup
+    if (!_client->isOpenTo(_host) || !_client->bodyDone()) {
+        sim::sleepFor((uint64_t)(config.latencyMs + config.tlsHandshakeMs));
+        sim::server().countHandshake();
+        _client->open(_host);
+    }
+
+    // Request out, first response byte back
+    uint64_t uploadMs = (uint64_t)(bodySize * 1000.0 / config.linkBytesPerSec);
+    sim::sleepFor((uint64_t)config.latencyMs + uploadMs);
+
+    _request.method = method;
+    _request.url = _url;
+    _request.bodySize = bodySize;
+    _response = sim::server().handle(_request);
+
+    if (_response.status < 0) {
+        _client->stop();
+        return _response.status;
+    }
+    _client->startBody(_response);
+    return _response.status;
+}
+
+int HTTPClient::getSize() {
+    return (int)_response.bodySize;
+}
+
+String HTTPClient::getString() {
+    std::string body;
+    uint8_t buffer[512];
+    size_t n;
+    while (_client && (n = _client->readBytes(buffer, sizeof(buffer))) > 0) {
+        body.append((const char*)buffer, n);
+    }
+    return String(body);
+}
+
+String HTTPClient::header(const char* name) {
+    if (strcasecmp(name, "ETag") == 0) {
+        return String(_response.etag);
+    }
+    return String();
+}
+
+// ========================================
+// SHA-256 (block hashes)
+// ========================================
+
+static const uint32_t kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static void sha256Block(uint32_t state[8], const unsigned char* p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kSha256K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224) {
+    static const uint32_t kInit[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    if (is224) return -1;
+    memcpy(ctx->state, kInit, sizeof(kInit));
+    ctx->length = 0;
+    ctx->used = 0;
+    return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t length) {
+    ctx->length += length;
+    while (length > 0) {
+        size_t n = std::min(length, sizeof(ctx->block) - ctx->used);
+        memcpy(ctx->block + ctx->used, input, n);
+        ctx->used += n;
+        input += n;
+        length -= n;
+        if (ctx->used == sizeof(ctx->block)) {
+            sha256Block(ctx->state, ctx->block);
+            ctx->used = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]) {
+    uint64_t bits = ctx->length * 8;
+    unsigned char pad[72] = {0x80};
+    size_t padLength = (ctx->used < 56 ? 56 : 120) - ctx->used;
+    for (int i = 0; i < 8; i++) {
+        pad[padLength + i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    mbedtls_sha256_update(ctx, pad, padLength + 8);
+    for (int i = 0; i < 8; i++) {
+        output[4 * i] = ctx->state[i] >> 24;
+        output[4 * i + 1] = ctx->state[i] >> 16;
+        output[4 * i + 2] = ctx->state[i] >> 8;
+        output[4 * i + 3] = ctx->state[i];
+    }
+    return 0;
+}
+
+// ========================================
+// TOY CIPHER (image decryption)
+// ========================================
+
+// SHA-256(key | block) stands in for AES - it is not encryption, but the CTR
+// and GCM counter handling around it follows mbedtls, so an image decrypted
+// with the wrong key, IV or tag is caught like on a device.
+static void toyBlock(const unsigned char* key, unsigned int keyBytes, const unsigned char in[16],
+                     unsigned char out[16]) {
+    unsigned char hash[32];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, key, keyBytes);
+    mbedtls_sha256_update(&ctx, in, 16);
+    mbedtls_sha256_finish(&ctx, hash);
+    memcpy(out, hash, 16);
+}
+
+void mbedtls_aes_init(mbedtls_aes_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_aes_free(mbedtls_aes_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    if (keybits != 128 && keybits != 256) return -1;
+    ctx->keyBytes = keybits / 8;
+    memcpy(ctx->key, key, ctx->keyBytes);
+    return 0;
+}
+
+int mbedtls_aes_crypt_ctr(mbedtls_aes_context* ctx, size_t length, size_t* nc_off, unsigned char nonce_counter[16],
+                          unsigned char stream_block[16], const unsigned char* input, unsigned char* output) {
+    size_t n = *nc_off;
+    for (size_t i = 0; i < length; i++) {
+        if (n == 0) {
+            toyBlock(ctx->key, ctx->keyBytes, nonce_counter, stream_block);
+            for (int j = 15; j >= 0 && ++nonce_counter[j] == 0; j--) {}  // 128-bit big-endian
+        }
+        output[i] = input[i] ^ stream_block[n];
+        n = (n + 1) & 15;
+    }
+    *nc_off = n;
+    return 0;
+}
+
+void mbedtls_gcm_init(mbedtls_gcm_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_gcm_free(mbedtls_gcm_context* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_gcm_setkey(mbedtls_gcm_context* ctx, mbedtls_cipher_id_t cipher, const unsigned char* key,
+                       unsigned int keybits) {
+    if (cipher != MBEDTLS_CIPHER_ID_AES || (keybits != 128 && keybits != 256)) return -1;
+    ctx->keyBytes = keybits / 8;
+    memcpy(ctx->key, key, ctx->keyBytes);
+    return 0;
+}
+
+int mbedtls_gcm_starts(mbedtls_gcm_context* ctx, int mode, const unsigned char* iv, size_t iv_len) {
+    if (iv_len == 0 || iv_len > 16) return -1;
+    // J0 = iv | 0x00000001 for the usual 96-bit IV
+    memset(ctx->counter, 0, sizeof(ctx->counter));
+    if (iv_len == 12) {
+        memcpy(ctx->counter, iv, 12);
+        ctx->counter[15] = 1;
+    } else {
+        unsigned char padded[16] = {0};
+        memcpy(padded, iv, iv_len);
+        toyBlock(ctx->key, ctx->keyBytes, padded, ctx->counter);
+    }
+    ctx->mode = mode;
+    ctx->streamOffset = 0;
+    mbedtls_sha256_init(&ctx->tag);
+    mbedtls_sha256_starts(&ctx->tag, 0);
+    mbedtls_sha256_update(&ctx->tag, ctx->key, ctx->keyBytes);
+    mbedtls_sha256_update(&ctx->tag, ctx->counter, sizeof(ctx->counter));
+    return 0;
+}
+
+int mbedtls_gcm_update(mbedtls_gcm_context* ctx, const unsigned char* input, size_t input_length,
+                       unsigned char* output, size_t output_size, size_t* output_length) {
+    if (output_size < input_length) return -1;
+    if (ctx->mode == MBEDTLS_GCM_DECRYPT) {
+        mbedtls_sha256_update(&ctx->tag, input, input_length);  // Before an in-place decrypt
+    }
+    size_t n = ctx->streamOffset;
+    for (size_t i = 0; i < input_length; i++) {
+        if (n == 0) {
+            for (int j = 15; j >= 12 && ++ctx->counter[j] == 0; j--) {}  // 32-bit counter, first block is J0 + 1
+            toyBlock(ctx->key, ctx->keyBytes, ctx->counter, ctx->stream);
+        }
+        output[i] = input[i] ^ ctx->stream[n];
+        n = (n + 1) & 15;
+    }
+    ctx->streamOffset = n;
+    if (ctx->mode == MBEDTLS_GCM_ENCRYPT) {
+        mbedtls_sha256_update(&ctx->tag, output, input_length);
+    }
+    *output_length = input_length;
+    return 0;
+}
+
+int mbedtls_gcm_finish(mbedtls_gcm_context* ctx, unsigned char*, size_t, size_t* output_length,
+                       unsigned char* tag, size_t tag_len) {
+    unsigned char hash[32];
+    mbedtls_sha256_finish(&ctx->tag, hash);
+    memcpy(tag, hash, std::min(tag_len, sizeof(hash)));
+    *output_length = 0;
+    return 0;
+}
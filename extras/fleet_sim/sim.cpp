@@ -0,0 +1,646 @@
+/**
+ * @file sim.cpp
+ * @brief Cooperative scheduler, virtual device state and simulated server
+ */
+
+#include "sim.h"
+
+#include <mbedtls/aes.h>
+#include <mbedtls/gcm.h>
+#include <mbedtls/sha256.h>
+#include <ucontext.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <queue>
+
+namespace sim {
+
+// Device stacks only need room for the library's buffers
+#define SIM_FIBER_STACK (128 * 1024)
+
+// ========================================
+// COOPERATIVE SCHEDULER
+// ========================================
+
+namespace {
+
+struct Fiber {
+    std::function<void()> body;
+    std::unique_ptr<char[]> stack;
+    ucontext_t context;
+    Device* device = nullptr;
+    bool finished = false;
+    uint32_t notifications = 0;
+    bool waitingNotify = false;
+    uint64_t wakeToken = 0;  // Wake-ups with an older token are stale
+};
+
+struct Event {
+    uint64_t timeMs;
+    uint64_t seq;  // FIFO among equal times keeps runs deterministic
+    Fiber* fiber;
+    uint64_t token;
+    bool operator>(const Event& other) const {
+        return timeMs != other.timeMs ? timeMs > other.timeMs : seq > other.seq;
+    }
+};
+
+ucontext_t g_schedulerContext;
+std::priority_queue<Event, std::vector<Event>, std::greater<Event>> g_events;
+std::vector<std::unique_ptr<Fiber>> g_fibers;
+Fiber* g_running = nullptr;
+std::atomic<uint64_t> g_nowMs{0};  // Also advanced by plain threads (host tests)
+uint64_t g_untilMs = 0;
+uint64_t g_seq = 0;
+bool g_stopping = false;
+std::mt19937 g_rng(1);
+int g_traceDevice = -1;
+std::function<void(const char*)> g_serialSink;
+
+// Plain threads outside the scheduler (host tests) are tasks of their own
+thread_local char t_threadTask;
+thread_local Device* t_threadDevice = nullptr;
+
+void fiberMain() {
+    Fiber* self = g_running;
+    if (!g_stopping) {
+        try {
+            self->body();
+        } catch (const Stop&) {
+            // Simulation over
+        } catch (const TaskExit&) {
+            // vTaskDelete(NULL)
+        } catch (const Restart&) {
+            // Restart from a background task: let the device's main coroutine handle it
+            Device* device = self->device;
+            if (device && device->mainTask && device->mainTask != self) {
+                device->restartPending = true;
+                notify(device->mainTask);
+            }
+        }
+    }
+    self->finished = true;
+    // Returning switches back to the scheduler through uc_link
+}
+
+void resume(Fiber* fiber) {
+    g_running = fiber;
+    swapcontext(&g_schedulerContext, &fiber->context);
+    g_running = nullptr;
+    if (fiber->finished) {
+        fiber->stack.reset();  // Keep memory flat with many short-lived tasks
+    }
+}
+
+void suspend(Fiber* self, uint64_t wakeMs) {
+    if (wakeMs != UINT64_MAX) {
+        g_events.push({wakeMs, g_seq++, self, self->wakeToken});
+    }
+    swapcontext(&self->context, &g_schedulerContext);
+    if (g_stopping) throw Stop();
+}
+
+Fiber* newFiber(std::function<void()> body, uint64_t startMs) {
+    g_fibers.emplace_back(new Fiber);
+    Fiber* fiber = g_fibers.back().get();
+    fiber->body = std::move(body);
+    fiber->stack.reset(new char[SIM_FIBER_STACK]);
+
+    getcontext(&fiber->context);
+    fiber->context.uc_stack.ss_sp = fiber->stack.get();
+    fiber->context.uc_stack.ss_size = SIM_FIBER_STACK;
+    fiber->context.uc_link = &g_schedulerContext;
+    makecontext(&fiber->context, fiberMain, 0);
+
+    g_events.push({startMs, g_seq++, fiber, 0});
+    return fiber;
+}
+
+} // namespace
+
+uint64_t nowMs() {
+    return g_nowMs;
+}
+
+void sleepFor(uint64_t ms) {
+    Fiber* self = g_running;
+    if (!self) {
+        g_nowMs += ms;  // Main program or a plain thread - nothing else to run
+        return;
+    }
+    if (g_stopping) throw Stop();
+
+    // Nobody else is due first - just move the clock, no switch
+    uint64_t wakeMs = g_nowMs + ms;
+    if (wakeMs <= g_untilMs && (g_events.empty() || g_events.top().timeMs > wakeMs)) {
+        g_nowMs = wakeMs;
+        return;
+    }
+
+    suspend(self, wakeMs);
+}
+
+void spawn(std::function<void()> body, uint64_t startMs) {
+    newFiber(std::move(body), startMs);
+}
+
+void* spawnTask(std::function<void()> body) {
+    Fiber* fiber = newFiber(std::move(body), g_nowMs);
+    fiber->device = currentDevice();
+    return fiber;
+}
+
+void* currentTask() {
+    return g_running ? (void*)g_running : (void*)&t_threadTask;
+}
+
+uint32_t waitNotify(uint64_t timeoutMs) {
+    Fiber* self = g_running;
+    if (!self) return 0;
+    if (g_stopping) throw Stop();
+
+    if (self->notifications == 0 && timeoutMs > 0) {
+        self->waitingNotify = true;
+        suspend(self, timeoutMs == UINT64_MAX ? UINT64_MAX : g_nowMs + timeoutMs);
+        self->waitingNotify = false;
+    }
+    uint32_t count = self->notifications;
+    self->notifications = 0;
+    return count;
+}
+
+void notify(void* task) {
+    Fiber* fiber = (Fiber*)task;
+    if (!fiber || fiber->finished) return;
+    fiber->notifications++;
+    if (fiber->waitingNotify) {
+        fiber->waitingNotify = false;
+        fiber->wakeToken++;  // Invalidates the pending timeout
+        g_events.push({g_nowMs, g_seq++, fiber, fiber->wakeToken});
+    }
+}
+
+void runUntil(uint64_t untilMs) {
+    g_untilMs = untilMs;
+    while (!g_events.empty() && g_events.top().timeMs <= untilMs) {
+        Event event = g_events.top();
+        g_events.pop();
+        if (event.token != event.fiber->wakeToken || event.fiber->finished) continue;
+        g_nowMs = std::max(g_nowMs.load(), event.timeMs);
+        resume(event.fiber);
+    }
+    g_nowMs = std::max(g_nowMs.load(), untilMs);
+}
+
+void shutdown() {
+    g_stopping = true;
+    for (auto& fiber : g_fibers) {
+        if (!fiber->finished) {
+            resume(fiber.get());  // Throws Stop inside the fiber to unwind its stack
+        }
+    }
+    g_fibers.clear();
+}
+
+std::mt19937& rng() {
+    return g_rng;
+}
+
+Device* currentDevice() {
+    return g_running ? g_running->device : t_threadDevice;
+}
+
+void bindDevice(Device* device) {
+    if (g_running) {
+        g_running->device = device;
+    } else {
+        t_threadDevice = device;
+    }
+}
+
+void setTraceDevice(int id) {
+    g_traceDevice = id;
+}
+
+bool tracing() {
+    Device* device = currentDevice();
+    return device && device->id == g_traceDevice;
+}
+
+void setSerialSink(std::function<void(const char* text)> sink) {
+    g_serialSink = std::move(sink);
+}
+
+const std::function<void(const char* text)>& serialSink() {
+    return g_serialSink;
+}
+
+// ========================================
+// SIMULATED MQTT BROKER
+// ========================================
+
+Broker& broker() {
+    static Broker instance;
+    return instance;
+}
+
+void Broker::subscribe(const std::string& topic, Deliver deliver) {
+    _subscriptions.push_back({currentDevice(), topic, std::move(deliver)});
+}
+
+void Broker::publish(const std::string& topic) {
+    sleepFor((uint64_t)server().config().latencyMs);
+
+    // Deliveries run on the publisher's stack, bound to each subscriber
+    Device* publisher = currentDevice();
+    std::vector<Subscription> matching;
+    for (const Subscription& s : _subscriptions) {
+        if (s.topic == topic) matching.push_back(s);
+    }
+    for (const Subscription& s : matching) {
+        bindDevice(s.device);
+        s.deliver(topic);
+        delivered++;
+    }
+    bindDevice(publisher);
+}
+
+void Broker::disconnect(Device* device) {
+    _subscriptions.erase(std::remove_if(_subscriptions.begin(), _subscriptions.end(),
+                                        [device](const Subscription& s) { return s.device == device; }),
+                         _subscriptions.end());
+}
+
+// ========================================
+// SIMULATED SERVER
+// ========================================
+
+static const std::string kFirmwarePrefix = "https://sim.local/fw-";
+static const std::string kBlocksPrefix = "https://sim.local/blocks-";
+static const char* kDeviceChannel = "stable";  // Devices only ever use this one
+
+const uint8_t Server::kImageKey[32] = {
+    0x41, 0x4f, 0x54, 0x41, 0x73, 0x69, 0x6d, 0x2d, 0x6b, 0x65, 0x79, 0x00, 0x01, 0x02, 0x03, 0x04,
+    0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14};
+
+Server& server() {
+    static Server instance;
+    return instance;
+}
+
+void Server::configure(const ServerConfig& config) {
+    _config = config;
+    _tokens = config.throttleRps;
+    _tokensAtMs = 0;
+    buildImages();
+    if (_config.fleet) {
+        buildFleet();
+    }
+}
+
+// Old and new image share everything but scattered runs of changed blocks
+// and the 1% the new one grew by. Own generator, so the shared random
+// sequence (and every run without --blocks) stays the same.
+void Server::buildImages() {
+    std::mt19937 gen(0x414F5442);
+    size_t blockSize = std::max<size_t>(1, _config.blockSize);
+
+    std::vector<uint8_t>& target = _images[_config.targetVersion];
+    target.resize(_config.imageSize);
+    for (uint8_t& byte : target) byte = (uint8_t)gen();
+
+    std::vector<uint8_t>& base = _images[_config.baseVersion];
+    base.assign(target.begin(), target.begin() + _config.imageSize * 99 / 100);
+
+    size_t blockCount = (target.size() + blockSize - 1) / blockSize;
+    size_t changedWanted = (size_t)(_config.changedFraction * blockCount);
+    std::vector<bool> changed(blockCount, false);
+    size_t changedCount = 0;
+    for (size_t i = base.size() / blockSize; i < blockCount; i++) {
+        changed[i] = true;  // Grown tail
+        changedCount++;
+    }
+    std::uniform_int_distribution<size_t> startAt(0, blockCount - 1);
+    std::uniform_int_distribution<size_t> runLength(1, 8);
+    while (changedCount < std::min(changedWanted, blockCount)) {
+        for (size_t i = startAt(gen), n = runLength(gen); i < blockCount && n > 0; i++, n--) {
+            if (changed[i]) continue;
+            changed[i] = true;
+            changedCount++;
+            // A few flipped bytes per block, like a recompiled function
+            size_t end = std::min(base.size(), (i + 1) * blockSize);
+            std::uniform_int_distribution<size_t> at(i * blockSize, std::max(i * blockSize, end - 1));
+            for (int k = 0; k < 16 && i * blockSize < end; k++) {
+                base[at(gen)] ^= 0x5A;
+            }
+        }
+    }
+
+    // Block lists as extras/tools/block_list.py writes them
+    for (auto& entry : _images) {
+        const std::vector<uint8_t>& image = entry.second;
+        std::string& list = _blockLists[entry.first];
+        uint8_t header[16] = {'A', 'O', 'T', 'B', 1, 32, 0, 0};
+        for (int k = 0; k < 4; k++) {
+            header[8 + k] = (uint8_t)(blockSize >> (8 * k));
+            header[12 + k] = (uint8_t)(image.size() >> (8 * k));
+        }
+        list.assign((const char*)header, sizeof(header));
+        for (size_t offset = 0; offset < image.size(); offset += blockSize) {
+            uint8_t hash[32];
+            mbedtls_sha256_context ctx;
+            mbedtls_sha256_init(&ctx);
+            mbedtls_sha256_starts(&ctx, 0);
+            mbedtls_sha256_update(&ctx, image.data() + offset, std::min(blockSize, image.size() - offset));
+            mbedtls_sha256_finish(&ctx, hash);
+            mbedtls_sha256_free(&ctx);
+            list.append((const char*)hash, sizeof(hash));
+        }
+    }
+}
+
+// Fleet tables as extras/tools/fleet_manifest.py writes them: every variant
+// on two channels, with the cipher cycling none / aes-ctr / aes-gcm. Each
+// firmware URL names its entry, so a device that read the wrong record is
+// caught when it downloads.
+void Server::buildFleet() {
+    for (const std::string& version : {_config.baseVersion, _config.targetVersion}) {
+        const std::vector<uint8_t>& image = _images[version];
+
+        // A fresh IV per image, derived from the version so runs repeat
+        uint8_t hash[32];
+        mbedtls_sha256_context sha;
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts(&sha, 0);
+        mbedtls_sha256_update(&sha, (const unsigned char*)version.data(), version.size());
+        mbedtls_sha256_finish(&sha, hash);
+        const uint8_t* ctrIv = hash;
+        const uint8_t* gcmIv = hash + 16;  // First 12 bytes
+
+        std::vector<uint8_t>& ctr = _encryptedImages[version + ".ctr"];
+        ctr.resize(image.size());
+        mbedtls_aes_context aes;
+        mbedtls_aes_init(&aes);
+        mbedtls_aes_setkey_enc(&aes, kImageKey, 256);
+        unsigned char counter[16], stream[16];
+        size_t offset = 0;
+        memcpy(counter, ctrIv, sizeof(counter));
+        mbedtls_aes_crypt_ctr(&aes, image.size(), &offset, counter, stream, image.data(), ctr.data());
+        mbedtls_aes_free(&aes);
+
+        std::vector<uint8_t>& gcm = _encryptedImages[version + ".gcm"];
+        gcm.resize(image.size());
+        uint8_t tag[16];
+        size_t produced = 0;
+        mbedtls_gcm_context ctx;
+        mbedtls_gcm_init(&ctx);
+        mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, kImageKey, 256);
+        mbedtls_gcm_starts(&ctx, MBEDTLS_GCM_ENCRYPT, gcmIv, 12);
+        mbedtls_gcm_update(&ctx, image.data(), image.size(), gcm.data(), gcm.size(), &produced);
+        mbedtls_gcm_finish(&ctx, NULL, 0, &produced, tag, sizeof(tag));
+        mbedtls_gcm_free(&ctx);
+
+        struct Entry {
+            std::string hw;
+            std::string channel;
+            std::string url;
+            uint8_t cipher;
+        };
+        std::vector<Entry> entries;
+        for (int variant = 0; variant < _config.fleetVariants; variant++) {
+            char hw[16];
+            snprintf(hw, sizeof(hw), "hw-%03d", variant);
+            uint8_t cipher = _config.fleetEncrypt ? variant % 3 : 0;
+            for (const char* channel : {kDeviceChannel, "beta"}) {
+                std::string url = kFirmwarePrefix + version + (cipher == 1 ? ".ctr" : cipher == 2 ? ".gcm" : "") +
+                                  ".bin?hw=" + hw + "/" + channel;
+                entries.push_back({hw, channel, url, cipher});
+            }
+        }
+        // NUL-padded keys sort like the plain strings
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.hw != b.hw ? a.hw < b.hw : a.channel < b.channel;
+        });
+
+        uint16_t recordSize = _config.fleetEncrypt ? 84 : 48;
+        uint32_t count = (uint32_t)entries.size();
+        uint32_t urlOffset = 16 + recordSize * count;
+        std::string& table = _fleetTables[version];
+        uint8_t header[16] = {'A', 'O', 'T', 'F', (uint8_t)(_config.fleetEncrypt ? 2 : 1), 0,
+                              (uint8_t)recordSize, (uint8_t)(recordSize >> 8)};
+        for (int k = 0; k < 4; k++) header[8 + k] = (uint8_t)(count >> (8 * k));
+        table.assign((const char*)header, sizeof(header));
+
+        std::string strings;
+        for (const Entry& entry : entries) {
+            std::vector<uint8_t> record(recordSize, 0);
+            memcpy(record.data(), entry.hw.data(), entry.hw.size());
+            memcpy(record.data() + 16, entry.channel.data(), entry.channel.size());
+            memcpy(record.data() + 24, version.data(), std::min<size_t>(version.size(), 16));
+            uint32_t at = urlOffset + (uint32_t)strings.size();
+            uint32_t length = (uint32_t)entry.url.size();
+            for (int k = 0; k < 4; k++) {
+                record[40 + k] = (uint8_t)(at >> (8 * k));
+                record[44 + k] = (uint8_t)(length >> (8 * k));
+            }
+            if (entry.cipher) {
+                record[48] = entry.cipher;
+                memcpy(record.data() + 52, entry.cipher == 1 ? ctrIv : gcmIv, entry.cipher == 1 ? 16 : 12);
+                if (entry.cipher == 2) memcpy(record.data() + 68, tag, sizeof(tag));
+            }
+            table.append((const char*)record.data(), record.size());
+            strings += entry.url;
+        }
+        table += strings;
+    }
+}
+
+std::string Server::hardwareId(const Device* device) const {
+    char hw[16];
+    snprintf(hw, sizeof(hw), "hw-%03d", device->id % std::max(1, _config.fleetVariants));
+    return hw;
+}
+
+const std::string& Server::fleetTable() const {
+    static const std::string kNone;
+    auto it = _fleetTables.find(currentVersion());
+    return it == _fleetTables.end() ? kNone : it->second;
+}
+
+const std::vector<uint8_t>& Server::image(const std::string& version) const {
+    static const std::vector<uint8_t> kNone;
+    auto it = _images.find(version);
+    return it == _images.end() ? kNone : it->second;
+}
+
+uint32_t Server::partitionSize() const {
+    uint32_t size = 0x1E0000;  // Default 4 MB flash layout
+    while (size < _config.imageSize) size += 0x10000;
+    return size;
+}
+
+std::string Server::currentVersion() const {
+    return nowMs() >= _config.releaseAtMs ? _config.targetVersion : _config.baseVersion;
+}
+
+Bucket& Server::bucketNow() {
+    size_t second = nowMs() / 1000;
+    if (_buckets.size() <= second) {
+        _buckets.resize(second + 1);
+    }
+    return _buckets[second];
+}
+
+bool Server::takeToken() {
+    if (_config.throttleRps <= 0) return true;
+
+    uint64_t now = nowMs();
+    _tokens = std::min(_config.throttleRps, _tokens + (now - _tokensAtMs) * _config.throttleRps / 1000.0);
+    _tokensAtMs = now;
+    if (_tokens < 1.0) return false;
+    _tokens -= 1.0;
+    return true;
+}
+
+void Server::countHandshake() {
+    bucketNow().handshakes++;
+}
+
+void Server::countBytes(uint64_t bytes) {
+    bucketNow().bytesServed += bytes;
+}
+
+double Server::streamBytesPerSec() const {
+    double share = _config.egressBytesPerSec / std::max(1, _activeStreams);
+    return std::min(_config.linkBytesPerSec, share);
+}
+
+Response Server::handle(const Request& request) {
+    Bucket& bucket = bucketNow();
+    Device* device = currentDevice();
+    Response response;
+
+    bool isFleet = request.url == kFleetUrl;
+    bool isManifest = request.url == kManifestUrl || isFleet;
+    bool isFirmware = request.url.compare(0, kFirmwarePrefix.size(), kFirmwarePrefix) == 0;
+    bool isBlockList = request.url.compare(0, kBlocksPrefix.size(), kBlocksPrefix) == 0;
+
+    if (isManifest) {
+        bucket.manifestRequests++;
+        if (device) device->manifestRequests++;
+    } else if (isFirmware || isBlockList) {
+        bucket.firmwareRequests++;
+        if (isBlockList) bucket.blockListRequests++;
+        if (isFirmware && request.hasRange) bucket.rangeRequests++;
+        if (device) device->firmwareRequests++;
+    } else {
+        bucket.otherRequests++;
+    }
+
+    if (!takeToken()) {
+        bucket.throttled++;
+        response.status = 503;  // S3 "SlowDown"
+        return response;
+    }
+
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    if (_config.errorRate > 0 && chance(rng()) < _config.errorRate) {
+        bucket.serverErrors++;
+        response.status = 500;
+        return response;
+    }
+
+    if (isFleet) {
+        const std::string& table = fleetTable();
+        response.etag = "\"fleet-" + currentVersion() + "\"";
+        response.status = 200;
+        response.body = table;
+        if (_config.fleetRange && request.hasRange && request.rangeStart < table.size()) {
+            uint64_t end = std::min<uint64_t>(request.rangeEnd, table.size() - 1);
+            response.body = table.substr(request.rangeStart, end - request.rangeStart + 1);
+            response.status = 206;
+        }
+        response.bodySize = response.body.size();
+        return response;
+    }
+
+    if (isManifest) {
+        std::string version = currentVersion();
+        response.etag = "\"" + version + "\"";
+        if (!request.ifNoneMatch.empty() && request.ifNoneMatch == response.etag) {
+            response.status = 304;
+            return response;
+        }
+        response.status = 200;
+        response.body = "{\"version\":\"" + version + "\",\"url\":\"" + kFirmwarePrefix + version + ".bin\"";
+        if (_config.blocks) {
+            response.body += ",\"blocks\":\"" + kBlocksPrefix + version + ".bin\"";
+        }
+        response.body += "}";
+        response.bodySize = response.body.size();
+        return response;
+    }
+
+    if (isFirmware || isBlockList) {
+        const std::string& prefix = isFirmware ? kFirmwarePrefix : kBlocksPrefix;
+        std::string name = request.url.substr(prefix.size());
+        std::string entry;  // Fleet entry the URL was read from
+        size_t query = name.find("?hw=");
+        if (query != std::string::npos) {
+            entry = name.substr(query + 4);
+            name.resize(query);
+        }
+        std::string version = name.substr(0, name.rfind(".bin"));
+        std::string cipher;
+        for (const char* suffix : {".ctr", ".gcm"}) {
+            size_t length = strlen(suffix);
+            if (version.size() > length && version.compare(version.size() - length, length, suffix) == 0) {
+                cipher = suffix;
+                version.resize(version.size() - length);
+            }
+        }
+        if (_images.count(version) == 0) {
+            response.status = 404;
+            return response;
+        }
+        if (device) {
+            device->downloading = version;  // Update.write() checks the decrypted bytes against it
+            if (!entry.empty() && entry != hardwareId(device) + "/" + kDeviceChannel) {
+                device->wrongEntries++;
+            }
+        }
+
+        response.status = 200;
+        if (isBlockList) {
+            response.body = _blockLists[version];
+            response.bodySize = response.body.size();
+            return response;
+        }
+
+        const std::vector<uint8_t>& data = cipher.empty() ? _images[version] : _encryptedImages[version + cipher];
+        response.etag = "\"fw-" + version + "\"";
+        response.data = &data;
+        response.bodySize = data.size();
+        if (request.hasRange && request.rangeStart < data.size()) {
+            uint64_t end = std::min<uint64_t>(request.rangeEnd, data.size() - 1);
+            response.dataOffset = request.rangeStart;
+            response.bodySize = end - request.rangeStart + 1;
+            response.status = 206;
+        }
+        if (_config.dropRate > 0 && chance(rng()) < _config.dropRate) {
+            std::uniform_int_distribution<uint64_t> at(0, response.bodySize - 1);
+            response.dropAfter = at(rng());
+        }
+        return response;
+    }
+
+    // Anything else (e.g. a report endpoint) is accepted and discarded
+    response.status = request.method == "POST" ? 204 : 404;
+    return response;
+}
+
+} // namespace sim
@@ -0,0 +1,258 @@
+/**
+ * @file sim.h
+ * @brief Discrete-event core of the fleet load simulator
+ *
+ * Every virtual device runs the real AwsOta code on its own coroutine stack
+ * (ucontext), and only one runs at a time: a device that calls delay() /
+ * vTaskDelay() or waits for network data hands control back to the
+ * scheduler, which resumes whichever device has the earliest wake-up time.
+ * Time is simulated, so a day-long rollout of thousands of devices runs in
+ * seconds and every run with the same seed gives the same result.
+ *
+ * Host tests may also call the library from plain std::threads outside the
+ * scheduler: each thread is then a task of its own and sleeps only advance
+ * the clock.
+ */
+
+#ifndef AWS_OTA_SIM_H
+#define AWS_OTA_SIM_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+// Thrown inside devices to unwind them when the simulation ends
+struct Stop {};
+
+// Thrown by ESP.restart()
+struct Restart {};
+
+// Thrown by vTaskDelete(NULL) to end the calling task
+struct TaskExit {};
+
+// ========================================
+// SIMULATED TIME
+// ========================================
+
+/** @brief Current simulated time in milliseconds */
+uint64_t nowMs();
+
+/** @brief Suspend the calling device for ms of simulated time */
+void sleepFor(uint64_t ms);
+
+/** @brief Start a device; its body first runs at startMs */
+void spawn(std::function<void()> body, uint64_t startMs);
+
+/** @brief Start a FreeRTOS-style task on the running device, returns its handle */
+void* spawnTask(std::function<void()> body);
+
+/** @brief Handle of the running device or task (a plain thread is a task of its own) */
+void* currentTask();
+
+/** @brief Block until notified or timeoutMs passes; returns and clears the count */
+uint32_t waitNotify(uint64_t timeoutMs);
+
+/** @brief Notify a task (may be called from any device) */
+void notify(void* task);
+
+/** @brief Run events until untilMs (or until every device has finished) */
+void runUntil(uint64_t untilMs);
+
+/** @brief Unwind every device and free its stack */
+void shutdown();
+
+/** @brief Shared random generator (only the running device touches it) */
+std::mt19937& rng();
+
+// ========================================
+// VIRTUAL DEVICE STATE
+// ========================================
+
+struct Device {
+    int id = 0;
+    std::string version;           // Firmware currently "running"
+    std::string downloading;       // Version of the last firmware GET
+    std::string flashed;           // Set by Update.end() - becomes version on restart
+    size_t updateSize = 0;
+    size_t updateWritten = 0;
+    uint64_t checks = 0;           // checkNow() calls
+    uint64_t manifestRequests = 0;
+    uint64_t firmwareRequests = 0;
+    uint64_t updates = 0;
+    uint64_t badFlashes = 0;       // Flashed images that differ from the release
+    bool updateCorrupt = false;    // A byte written so far differs from the release
+    uint64_t wrongEntries = 0;     // Firmware GETs from another variant's fleet entry
+    int64_t convergedAtMs = -1;    // When it first ran the target version
+    std::map<std::string, std::string> nvs;  // Preferences blobs, survive restarts
+    void* mainTask = nullptr;      // Woken when a background task restarts the device
+    bool restartPending = false;
+};
+
+/** @brief Device that is running (nullptr outside devices) */
+Device* currentDevice();
+
+/** @brief Bind the running device (or plain thread) to its state */
+void bindDevice(Device* device);
+
+/** @brief Print Serial output of this device id (-1 = none) */
+void setTraceDevice(int id);
+bool tracing();
+
+/** @brief Send all Serial output to sink instead (host tests; may be called from any thread) */
+void setSerialSink(std::function<void(const char* text)> sink);
+const std::function<void(const char* text)>& serialSink();
+
+// ========================================
+// SIMULATED HTTP SERVER (S3 / API Gateway stand-in)
+// ========================================
+
+struct ServerConfig {
+    std::string baseVersion = "1.0.0";
+    std::string targetVersion = "1.1.0";
+    uint64_t releaseAtMs = 60 * 1000;  // When the manifest switches to targetVersion
+    size_t imageSize = 1024 * 1024;    // New image; the old one is 1% smaller
+    bool blocks = false;               // Publish a block-hash list (incremental sync)
+    uint32_t blockSize = 4096;
+    double changedFraction = 0.05;     // Blocks of the new image that differ from the old one
+    bool fleet = false;                // Serve a binary fleet table instead of the JSON manifest
+    int fleetVariants = 40;            // Hardware variants in it (two channels each)
+    bool fleetRange = true;            // Honour Range requests for the fleet table
+    bool fleetEncrypt = true;          // Encrypt two thirds of the variants (format 2)
+    double latencyMs = 80;             // One network round trip
+    double tlsHandshakeMs = 400;       // Extra cost of a new TLS connection
+    double linkBytesPerSec = 250e3;    // Per-device download bandwidth
+    double egressBytesPerSec = 1e9;    // Shared server egress
+    double errorRate = 0.0;            // Fraction of requests answered with 500
+    double dropRate = 0.0;             // Fraction of firmware downloads cut mid-stream
+    double throttleRps = 0.0;          // Token-bucket limit, 503 beyond it (0 = off)
+};
+
+struct Request {
+    std::string method;
+    std::string url;
+    bool hasRange = false;
+    uint64_t rangeStart = 0;
+    uint64_t rangeEnd = 0;  // Inclusive
+    std::string ifNoneMatch;
+    size_t bodySize = 0;    // Request body (POST)
+};
+
+struct Response {
+    int status = -1;
+    std::string body;          // Small bodies (manifest, block list)
+    const std::vector<uint8_t>* data = nullptr;  // Firmware image the body is cut from
+    uint64_t dataOffset = 0;
+    uint64_t bodySize = 0;
+    uint64_t dropAfter = UINT64_MAX;
+    std::string etag;
+};
+
+/** @brief Per-second traffic counters */
+struct Bucket {
+    uint32_t manifestRequests = 0;
+    uint32_t firmwareRequests = 0;
+    uint32_t otherRequests = 0;
+    uint32_t blockListRequests = 0;  // Also counted as firmware requests
+    uint32_t rangeRequests = 0;      // Firmware requests with a Range header
+    uint32_t serverErrors = 0;
+    uint32_t throttled = 0;
+    uint32_t handshakes = 0;
+    uint64_t bytesServed = 0;
+};
+
+class Server {
+public:
+    static constexpr const char* kManifestUrl = "https://sim.local/manifest.json";
+    static constexpr const char* kReportUrl = "https://sim.local/report";
+    static constexpr const char* kFleetUrl = "https://sim.local/fleet.bin";
+    static const uint8_t kImageKey[32];  // Provisioned with storeDecryptionKey()
+
+    void configure(const ServerConfig& config);
+    const ServerConfig& config() const { return _config; }
+
+    Response handle(const Request& request);
+
+    /** @brief Firmware image of a version (old or new), empty if unknown */
+    const std::vector<uint8_t>& image(const std::string& version) const;
+
+    /** @brief Flash partition size that fits every image */
+    uint32_t partitionSize() const;
+
+    /** @brief Fleet table hardware ID of a device (variants are shared round robin) */
+    std::string hardwareId(const Device* device) const;
+
+    /** @brief Fleet table of the version currently released */
+    const std::string& fleetTable() const;
+
+    /** @brief Bandwidth for one stream given current contention */
+    double streamBytesPerSec() const;
+
+    void streamOpened() { _activeStreams++; }
+    void streamClosed() { _activeStreams--; }
+    void countHandshake();
+    void countBytes(uint64_t bytes);
+
+    const std::vector<Bucket>& buckets() const { return _buckets; }
+
+private:
+    Bucket& bucketNow();
+    bool takeToken();
+    std::string currentVersion() const;
+
+    void buildImages();
+    void buildFleet();
+
+    ServerConfig _config;
+    std::map<std::string, std::vector<uint8_t>> _images;
+    std::map<std::string, std::string> _blockLists;
+    std::map<std::string, std::vector<uint8_t>> _encryptedImages;  // "<version>.ctr", "<version>.gcm"
+    std::map<std::string, std::string> _fleetTables;                // By version
+    std::vector<Bucket> _buckets;
+    int _activeStreams = 0;
+    double _tokens = 0;
+    uint64_t _tokensAtMs = 0;
+};
+
+Server& server();
+
+// ========================================
+// SIMULATED MQTT BROKER
+// ========================================
+
+class Broker {
+public:
+    static constexpr const char* kUri = "mqtts://sim.local:8883";
+
+    typedef std::function<void(const std::string& topic)> Deliver;
+
+    /** @brief Subscribe the running device; deliver runs bound to that device */
+    void subscribe(const std::string& topic, Deliver deliver);
+
+    /** @brief Deliver to every subscriber after one network latency */
+    void publish(const std::string& topic);
+
+    /** @brief Drop the subscriptions of a device (restart) */
+    void disconnect(Device* device);
+
+    uint64_t connections = 0;
+    uint64_t delivered = 0;
+
+private:
+    struct Subscription {
+        Device* device;
+        std::string topic;
+        Deliver deliver;
+    };
+    std::vector<Subscription> _subscriptions;
+};
+
+Broker& broker();
+
+} // namespace sim
+
+#endif // AWS_OTA_SIM_H
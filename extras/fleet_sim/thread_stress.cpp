@@ -0,0 +1,178 @@
+/**
+ * @file thread_stress.cpp
+ * @brief Host stress test of concurrent AwsOta::checkNow() calls on real threads
+ *
+ * Starts N std::threads that call checkNow() on one AwsOta at the same time,
+ * against the fleet simulator's server and shims. The first caller runs the
+ * check; its onStart callback holds it until every other thread is waiting
+ * on the in-flight check, then makes a re-entrant checkNow(). Each round
+ * asserts that:
+ *   - exactly one manifest GET (and at most one firmware GET) was made
+ *   - every caller got the same result
+ *   - the re-entrant call from the checking task returned false
+ * Rounds alternate between "update available" (the owner flashes and
+ * restarts, everyone gets true) and "up to date" (everyone gets false).
+ *
+ * Build:  make thread_stress ARDUINOJSON_DIR=~/Arduino/libraries/ArduinoJson/src
+ * Run:    ./thread_stress --threads 16 --rounds 50
+ *
+ * Exit code is 1 if any round fails or the run deadlocks (see --timeout-sec).
+ */
+
+#include <AwsS3Ota.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "sim.h"
+
+// Waiters log this once they share the in-flight check
+static const char* kWaitingLog = "waiting for its result";
+
+static std::mutex s_logMutex;
+static std::condition_variable s_logChanged;
+static int s_waiting = 0;
+
+static int runRound(int round, int threads, const sim::ServerConfig& config) {
+    bool update = round % 2 == 0;
+    sim::Device device;
+    device.id = round;
+    device.version = update ? config.baseVersion : config.targetVersion;
+
+    {
+        std::lock_guard<std::mutex> lock(s_logMutex);
+        s_waiting = 0;
+    }
+
+    AwsOta ota;
+    ota.setDebug(true);  // The waiting log is how we know everyone is queued
+    ota.setAutoTaskSuspend(false);
+    ota.begin(sim::Server::kManifestUrl, device.version.c_str(), "");
+
+    std::atomic<int> starts{0};
+    std::atomic<bool> queued{false};
+    int reentrant = -1;
+    ota.onStart([&] {
+        starts++;
+        std::unique_lock<std::mutex> lock(s_logMutex);
+        queued = s_logChanged.wait_for(lock, std::chrono::seconds(10),
+                                       [&] { return s_waiting >= threads - 1; });
+        lock.unlock();
+        reentrant = ota.checkNow() ? 1 : 0;
+    });
+
+    std::vector<int> results(threads, -1);
+    std::vector<std::thread> pool;
+    std::atomic<int> ready{0};
+    for (int i = 0; i < threads; i++) {
+        pool.emplace_back([&, i] {
+            sim::bindDevice(&device);
+            ready++;
+            while (ready < threads) {
+                std::this_thread::yield();
+            }
+            try {
+                results[i] = ota.checkNow() ? 1 : 0;
+            } catch (const sim::Restart&) {
+                results[i] = 1;  // The owner flashed and rebooted
+            }
+        });
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    int failures = 0;
+    auto expect = [&](bool ok, const char* what) {
+        if (!ok) {
+            printf("Round %d (%s): FAIL: %s\n", round, update ? "update" : "up to date", what);
+            failures++;
+        }
+    };
+
+    int expected = update ? 1 : 0;
+    expect(starts == 1, "more than one check ran");
+    expect(queued, "other callers never queued behind the check");
+    expect(reentrant == 0, "re-entrant checkNow() from the checking task did not return false");
+    for (int result : results) {
+        if (result != expected) {
+            expect(false, "callers got different results");
+            break;
+        }
+    }
+    expect(device.manifestRequests == 1, "expected exactly one manifest GET");
+
+    if (update) {
+        expect(device.firmwareRequests == 1, "expected exactly one firmware GET");
+        expect(device.flashed == config.targetVersion && device.badFlashes == 0,
+               "flashed image differs from the release");
+        expect(ota.getState() == OTA_STATE_PENDING_REBOOT, "state is not PENDING_REBOOT");
+        sim::bindDevice(&device);
+        expect(ota.checkNow() && device.manifestRequests == 1,
+               "check after the update did not short-circuit to true");
+    } else {
+        expect(device.firmwareRequests == 0, "firmware fetched while up to date");
+        expect(ota.getState() == OTA_STATE_IDLE, "state is not IDLE");
+    }
+    sim::bindDevice(nullptr);
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    int threads = 16;
+    int rounds = 50;
+    int timeoutSec = 60;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--threads") == 0) threads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--rounds") == 0) rounds = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--timeout-sec") == 0) timeoutSec = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "Usage: thread_stress [--threads N] [--rounds R] [--timeout-sec S]\n");
+            return 2;
+        }
+    }
+    if (threads < 2 || rounds < 1) {
+        fprintf(stderr, "Need at least 2 threads and 1 round\n");
+        return 2;
+    }
+
+    // A deadlocked caller never returns - fail instead of hanging CI
+    std::thread([timeoutSec] {
+        std::this_thread::sleep_for(std::chrono::seconds(timeoutSec));
+        printf("Thread stress: FAIL: not finished after %d s (deadlock?)\n", timeoutSec);
+        fflush(stdout);
+        _exit(1);
+    }).detach();
+
+    sim::ServerConfig config;
+    config.releaseAtMs = 0;
+    config.imageSize = 64 * 1024;
+    config.latencyMs = 20;
+    config.tlsHandshakeMs = 50;
+    sim::server().configure(config);
+
+    sim::setSerialSink([](const char* text) {
+        if (strstr(text, kWaitingLog)) {
+            std::lock_guard<std::mutex> lock(s_logMutex);
+            s_waiting++;
+            s_logChanged.notify_all();
+        }
+    });
+
+    int failed = 0;
+    for (int round = 0; round < rounds; round++) {
+        if (runRound(round, threads, config) > 0) failed++;
+    }
+
+    printf("Thread stress: %d threads x %d rounds, %d failed\n", threads, rounds, failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Build the block-hash list used by AwsOta incremental sync, or estimate
+how many bytes a release will transfer.
+
+Upload the .blocks file next to the firmware and reference it from the
+manifest:
+
+    {"version": "1.3.0",
+     "url": "https://bucket.s3.amazonaws.com/fw-1.3.0.bin",
+     "blocks": "https://bucket.s3.amazonaws.com/fw-1.3.0.blocks"}
+
+Usage:
+    block_list.py build new.bin new.blocks [--block-size 4096]
+    block_list.py compare running.bin new.bin [--block-size 4096]
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = b"AOTB"
+FORMAT_VERSION = 1
+HASH_LEN = 32
+HEADER = struct.Struct("<4sBBHII")
+
+# Rough per-request cost of a Range GET (request + response headers)
+RANGE_OVERHEAD = 600
+
+
+def block_hashes(image, block_size):
+    return [hashlib.sha256(image[i:i + block_size]).digest()
+            for i in range(0, len(image), block_size)]
+
+
+def build(image, block_size):
+    header = HEADER.pack(MAGIC, FORMAT_VERSION, HASH_LEN, 0, block_size, len(image))
+    return header + b"".join(block_hashes(image, block_size))
+
+
+def compare(running, new, block_size):
+    """Mirror the device: hash running blocks, coalesce changed runs into ranges."""
+    ours = block_hashes(running, block_size)
+    theirs = block_hashes(new, block_size)
+    changed = [i >= len(ours) or ours[i] != h for i, h in enumerate(theirs)]
+
+    ranges = 0
+    changed_bytes = 0
+    for i, is_changed in enumerate(changed):
+        if not is_changed:
+            continue
+        changed_bytes += min(block_size, len(new) - i * block_size)
+        if i == 0 or not changed[i - 1]:
+            ranges += 1
+
+    list_bytes = HEADER.size + HASH_LEN * len(theirs)
+    if all(changed):
+        # Device falls back to one full GET after reading the block list
+        return len(new) + list_bytes, 1, sum(changed), len(changed)
+    return changed_bytes + list_bytes + ranges * RANGE_OVERHEAD, ranges, sum(changed), len(changed)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=["build", "compare"])
+    parser.add_argument("first")
+    parser.add_argument("second")
+    parser.add_argument("--block-size", type=int, default=4096)
+    args = parser.parse_args()
+
+    if args.block_size < 512:
+        sys.exit("block size must be at least 512 (devices reject smaller ones)")
+
+    with open(args.first, "rb") as f:
+        first = f.read()
+
+    if args.command == "build":
+        blob = build(first, args.block_size)
+        with open(args.second, "wb") as f:
+            f.write(blob)
+        print(f"Wrote {args.second} ({len(blob)} bytes, "
+              f"{(len(first) + args.block_size - 1) // args.block_size} blocks)")
+    else:
+        with open(args.second, "rb") as f:
+            new = f.read()
+        transferred, ranges, changed, total = compare(first, new, args.block_size)
+        print(f"{changed}/{total} blocks changed, {ranges} range requests")
+        print(f"~{transferred} bytes transferred vs {len(new)} for a full download "
+              f"({100.0 * transferred / len(new):.1f}%)")
+
+
+if __name__ == "__main__":
+    main()
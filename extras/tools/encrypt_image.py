@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""
+Encrypt a firmware image for AwsOta inline decryption and print the
+manifest fields that go with it.
+
+The key is the one provisioned on the devices with
+ota.storeDecryptionKey(); keep it out of the bucket. A fresh IV is drawn
+for every image - never reuse one with the same key.
+
+    {"version": "1.3.0",
+     "url": "https://bucket.s3.amazonaws.com/fw-1.3.0.enc",
+     "enc": "aes-gcm", "iv": "...", "tag": "..."}
+
+Usage:
+    encrypt_image.py keygen fw.key [--bits 256]
+    encrypt_image.py encrypt fw.key fw.bin fw.enc [--mode gcm|ctr]
+
+Needs the "cryptography" package (pip install cryptography).
+"""
+
+import argparse
+import json
+import os
+import sys
+
+
+def keygen(path, bits):
+    key = os.urandom(bits // 8)
+    with open(path, "w") as f:
+        f.write(key.hex() + "\n")
+    # C initializer for a provisioning sketch
+    print("const uint8_t key[%d] = {%s};" % (len(key), ", ".join("0x%02x" % b for b in key)))
+
+
+def encrypt(key, image, mode):
+    from cryptography.hazmat.primitives.ciphers import Cipher, algorithms, modes
+    from cryptography.hazmat.primitives.ciphers.aead import AESGCM
+
+    if mode == "gcm":
+        iv = os.urandom(12)
+        sealed = AESGCM(key).encrypt(iv, image, None)
+        body, tag = sealed[:-16], sealed[-16:]
+        return body, {"enc": "aes-gcm", "iv": iv.hex(), "tag": tag.hex()}
+
+    # CTR: 16-byte initial counter block, incremented as a big-endian integer (as mbedtls does)
+    iv = os.urandom(16)
+    encryptor = Cipher(algorithms.AES(key), modes.CTR(iv)).encryptor()
+    body = encryptor.update(image) + encryptor.finalize()
+    return body, {"enc": "aes-ctr", "iv": iv.hex()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=["keygen", "encrypt"])
+    parser.add_argument("key")
+    parser.add_argument("image", nargs="?")
+    parser.add_argument("output", nargs="?")
+    parser.add_argument("--bits", type=int, choices=[128, 256], default=256)
+    parser.add_argument("--mode", choices=["gcm", "ctr"], default="gcm")
+    args = parser.parse_args()
+
+    if args.command == "keygen":
+        keygen(args.key, args.bits)
+        return
+
+    if not args.image or not args.output:
+        parser.error("encrypt needs an input and an output image")
+    with open(args.key) as f:
+        key = bytes.fromhex(f.read().strip())
+    if len(key) not in (16, 32):
+        sys.exit("key must be 16 or 32 bytes")
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    body, fields = encrypt(key, image, args.mode)
+    with open(args.output, "wb") as f:
+        f.write(body)
+    print(json.dumps(fields))
+
+
+if __name__ == "__main__":
+    main()
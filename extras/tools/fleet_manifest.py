@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+Build or inspect a binary fleet manifest for AwsOta::setFleetManifest().
+
+Input is a JSON list with one entry per hardware variant and channel:
+
+    [
+      {"hw": "sensor-v3", "channel": "stable", "version": "1.4.0",
+       "url": "https://bucket.s3.amazonaws.com/sensor-v3-1.4.0.bin"},
+      {"hw": "gateway-v1", "channel": "stable", "version": "2.0.1",
+       "url": "https://bucket.s3.amazonaws.com/gateway-v1-2.0.1.enc",
+       "enc": "aes-gcm", "iv": "...", "tag": "..."},
+      ...
+    ]
+
+URLs are https://, or http:// for a LAN mirror read with OtaSocketTransport
+(the whole table must then be served over http:// too).
+
+"enc", "iv" and "tag" are the fields printed by encrypt_image.py. A table
+with encrypted entries is written in format 2, which devices running a
+library without fleet encryption support reject rather than flash
+ciphertext; tables without them stay in format 1.
+
+Usage:
+    fleet_manifest.py build fleet.json fleet.bin
+    fleet_manifest.py dump fleet.bin
+"""
+
+import json
+import struct
+import sys
+
+MAGIC = b"AOTF"
+HEADER = struct.Struct("<4sBBHII")
+RECORD = struct.Struct("<16s8s16sII")
+ENCRYPTION = struct.Struct("<B3x16s16s")  # Appended to each record in format 2
+CIPHERS = {"aes-ctr": (1, 16, False), "aes-gcm": (2, 12, True)}  # id, iv bytes, has tag
+HW_ID_LEN = 16
+CHANNEL_LEN = 8
+VERSION_LEN = 16
+
+
+def _field(value, size, name):
+    raw = value.encode("ascii")
+    if len(raw) > size:
+        sys.exit(f"{name} '{value}' is longer than {size} bytes")
+    return raw.ljust(size, b"\0")
+
+
+def _encryption(entry):
+    enc = entry.get("enc")
+    if not enc:
+        return ENCRYPTION.pack(0, b"", b"")
+    if enc not in CIPHERS:
+        sys.exit(f"unknown enc '{enc}' for {entry['hw']}")
+    cipher, iv_len, has_tag = CIPHERS[enc]
+    iv = bytes.fromhex(entry.get("iv", ""))
+    tag = bytes.fromhex(entry.get("tag", "")) if has_tag else b""
+    if len(iv) != iv_len or (has_tag and len(tag) != 16):
+        sys.exit(f"{enc} for {entry['hw']} needs a {iv_len}-byte iv" + (" and a 16-byte tag" if has_tag else ""))
+    return ENCRYPTION.pack(cipher, iv, tag)
+
+
+def build(entries):
+    rows = []
+    seen = set()
+    for entry in entries:
+        key = (_field(entry["hw"], HW_ID_LEN, "hw"),
+               _field(entry.get("channel", "stable"), CHANNEL_LEN, "channel"))
+        if key in seen:
+            sys.exit(f"duplicate entry for {entry['hw']}/{entry.get('channel', 'stable')}")
+        seen.add(key)
+        url = entry["url"]
+        if url.startswith("http://"):
+            # LAN mirror served by OtaSocketTransport - no TLS
+            print(f"warning: {entry['hw']} uses plain http:// (OtaSocketTransport only)"
+                  + ("" if entry.get("enc") == "aes-gcm" else "; consider an aes-gcm image"),
+                  file=sys.stderr)
+        elif not url.startswith("https://"):
+            sys.exit(f"url for {entry['hw']} must be https:// (or http:// for a LAN mirror)")
+        rows.append((key, _field(entry["version"], VERSION_LEN, "version"),
+                     entry["url"].encode("ascii"), _encryption(entry)))
+
+    # The device binary-searches on the raw 24-byte key, so sort the same way
+    rows.sort(key=lambda row: row[0][0] + row[0][1])
+
+    encrypted = any(row[3][0] != 0 for row in rows)
+    fmt = 2 if encrypted else 1
+    record_size = RECORD.size + (ENCRYPTION.size if encrypted else 0)
+
+    strings_offset = HEADER.size + record_size * len(rows)
+    records = bytearray()
+    strings = bytearray()
+    for (hw, channel), version, url, encryption in rows:
+        records += RECORD.pack(hw, channel, version, strings_offset + len(strings), len(url))
+        if encrypted:
+            records += encryption
+        strings += url
+
+    header = HEADER.pack(MAGIC, fmt, 0, record_size, len(rows), 0)
+    return header + records + strings
+
+
+def dump(blob):
+    magic, fmt, _, record_size, count, _ = HEADER.unpack_from(blob, 0)
+    if magic != MAGIC or fmt not in (1, 2):
+        sys.exit("not a fleet manifest")
+    print(f"{count} entries, format {fmt}, {record_size}-byte records, {len(blob)} bytes total")
+    names = {cipher: name for name, (cipher, _, _) in CIPHERS.items()}
+    for i in range(count):
+        offset = HEADER.size + i * record_size
+        hw, channel, version, url_offset, url_length = RECORD.unpack_from(blob, offset)
+        url = blob[url_offset:url_offset + url_length].decode("ascii")
+        hw, channel, version = (f.rstrip(b"\0").decode("ascii") for f in (hw, channel, version))
+        enc = ""
+        if fmt >= 2:
+            cipher, _, _ = ENCRYPTION.unpack_from(blob, offset + RECORD.size)
+            enc = f" [{names.get(cipher, cipher)}]" if cipher else ""
+        print(f"  {hw:16} {channel:8} {version:16} {url}{enc}")
+
+
+def main(argv):
+    if len(argv) == 4 and argv[1] == "build":
+        with open(argv[2]) as f:
+            blob = build(json.load(f))
+        with open(argv[3], "wb") as f:
+            f.write(blob)
+        print(f"Wrote {argv[3]} ({len(blob)} bytes)")
+    elif len(argv) == 3 and argv[1] == "dump":
+        with open(argv[2], "rb") as f:
+            dump(f.read())
+    else:
+        sys.exit(__doc__)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
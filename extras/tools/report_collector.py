@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Minimal HTTP collector for AwsOta outcome reports, for local testing or as a
+reference for decoding them in a real backend.
+
+Reports are POSTed on the manifest connection, so the endpoint must be
+HTTPS and should live on the manifest host. To test locally, serve the
+manifest and this collector from the same TLS host (--cert/--key, with the
+device's root CA set to match) and point the device at it:
+
+    ota.setReportEndpoint("https://192.168.1.10:8443/reports");
+
+Each batch is decoded and printed as one JSON line per record.
+
+Usage:
+    report_collector.py serve [--port 8080] [--cert c.pem --key k.pem] [--out reports.jsonl]
+    report_collector.py decode batch.bin
+"""
+
+import argparse
+import json
+import ssl
+import struct
+import sys
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+MAGIC = b"AORP"
+FORMAT_VERSION = 1
+HEADER = struct.Struct("<4sBBH6sH")
+RECORD = struct.Struct("<IIIIBBh")
+
+RESULTS = {0: "updated", 1: "manifest_failed", 2: "flash_failed"}
+
+
+def decode(batch):
+    if len(batch) < HEADER.size:
+        raise ValueError("batch too short")
+    magic, fmt, count, _, mac, _ = HEADER.unpack_from(batch)
+    if magic != MAGIC or fmt != FORMAT_VERSION:
+        raise ValueError("not an AwsOta report batch")
+
+    device = ":".join("%02x" % b for b in mac)
+    pos = HEADER.size
+    records = []
+    for _ in range(count):
+        time, duration, size, rate, result, attempts, error = RECORD.unpack_from(batch, pos)
+        pos += RECORD.size
+        versions = []
+        for _ in range(2):
+            length = batch[pos]
+            versions.append(batch[pos + 1:pos + 1 + length].decode("utf-8", "replace"))
+            pos += 1 + length
+        records.append({
+            "device": device,
+            "time": time or None,
+            "from": versions[0],
+            "to": versions[1],
+            "result": RESULTS.get(result, result),
+            "attempts": attempts,
+            "error": error,
+            "duration_ms": duration,
+            "bytes": size,
+            "bytes_per_sec": rate,
+        })
+    return records
+
+
+def serve(port, out, cert=None, key=None):
+    class Handler(BaseHTTPRequestHandler):
+        def do_POST(self):
+            body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+            try:
+                records = decode(body)
+            except (ValueError, IndexError, struct.error) as e:
+                self.send_error(400, str(e))
+                return
+            for record in records:
+                line = json.dumps(record)
+                print(line, flush=True)
+                if out:
+                    out.write(line + "\n")
+                    out.flush()
+            self.send_response(204)
+            self.end_headers()
+
+        def log_message(self, format, *args):
+            sys.stderr.write("%s %s\n" % (self.address_string(), format % args))
+
+    # HTTP/1.1 so devices can keep the connection alive
+    Handler.protocol_version = "HTTP/1.1"
+    server = HTTPServer(("", port), Handler)
+    if cert:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(cert, key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+    print("Collecting reports on port %d%s" % (port, " (TLS)" if cert else ""), file=sys.stderr)
+    server.serve_forever()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=["serve", "decode"])
+    parser.add_argument("file", nargs="?")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--cert")
+    parser.add_argument("--key")
+    parser.add_argument("--out")
+    args = parser.parse_args()
+
+    if args.command == "decode":
+        if not args.file:
+            parser.error("decode needs a batch file")
+        with open(args.file, "rb") as f:
+            for record in decode(f.read()):
+                print(json.dumps(record))
+    else:
+        out = open(args.out, "a") if args.out else None
+        try:
+            serve(args.port, out, args.cert, args.key)
+        except KeyboardInterrupt:
+            pass
+
+
+if __name__ == "__main__":
+    main()
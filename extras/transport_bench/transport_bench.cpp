@@ -0,0 +1,341 @@
+/**
+ * @file transport_bench.cpp
+ * @brief Host benchmark of OtaSocketTransport against a local HTTP server
+ *
+ * Starts a small HTTP/1.1 server on 127.0.0.1 that serves a synthetic
+ * firmware image (with Range support) and a chunked JSON manifest, then
+ * drives OtaSocketTransport through the request patterns AwsOta uses:
+ *
+ *   - full image download with different read sizes and receive buffers
+ *   - small Range requests (fleet manifest lookup) with and without keep-alive
+ *   - chunked manifest body with ETag
+ *
+ * Every response is checked byte for byte. Loopback has no real latency, so
+ * the keep-alive numbers show per-request overhead only; on a device the
+ * saved connection setup is a round trip (plus a TLS handshake for https://).
+ * Compare the TLS transports on the device with examples/TransportBenchmark.
+ *
+ * Build:  make
+ * Run:    ./transport_bench --mb 64 --read 512 --read 4096
+ */
+
+#include <OtaSocketTransport.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* kManifest = "{\"version\":\"1.2.0\",\"url\":\"http://127.0.0.1/image\"}";
+static const char* kEtag = "\"5f3a-manifest\"";
+
+struct Options {
+    size_t imageBytes = 64 * 1024 * 1024;
+    std::vector<size_t> reads = {512, 4096};
+    int requests = 200;
+};
+
+// ========================================
+// LOCAL HTTP SERVER
+// ========================================
+
+static inline uint8_t imageByte(uint64_t offset) {
+    return (uint8_t)(offset * 31 + (offset >> 11));
+}
+
+class Server {
+public:
+    explicit Server(size_t imageBytes) : _imageBytes(imageBytes) {}
+
+    bool start() {
+        _listen = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (bind(_listen, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(_listen, 16) != 0 ||
+            getsockname(_listen, (sockaddr*)&addr, &length) != 0) {
+            return false;
+        }
+        _port = ntohs(addr.sin_port);
+        std::thread([this] { acceptLoop(); }).detach();
+        return true;
+    }
+
+    uint16_t port() const { return _port; }
+    int connections() const { return _connections; }
+
+private:
+    void acceptLoop() {
+        for (;;) {
+            int fd = accept(_listen, NULL, NULL);
+            if (fd < 0) return;
+            int one = 1;  // Head and body are separate sends
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            _connections++;
+            std::thread([this, fd] { serve(fd); }).detach();
+        }
+    }
+
+    // One connection: requests in a row until "Connection: close" or EOF
+    void serve(int fd) {
+        std::string pending;
+        char buffer[4096];
+        for (;;) {
+            size_t end;
+            while ((end = pending.find("\r\n\r\n")) == std::string::npos) {
+                ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                pending.append(buffer, n);
+            }
+            std::string head = pending.substr(0, end);
+            pending.erase(0, end + 4);
+
+            bool keepAlive = head.find("Connection: close") == std::string::npos;
+            if (!respond(fd, head, keepAlive) || !keepAlive) {
+                close(fd);
+                return;
+            }
+        }
+    }
+
+    bool respond(int fd, const std::string& head, bool keepAlive) {
+        const char* connection = keepAlive ? "keep-alive" : "close";
+        char header[256];
+
+        if (head.compare(0, 14, "GET /manifest ") == 0) {
+            // Chunked, split mid-string to exercise the decoder
+            size_t half = strlen(kManifest) / 2;
+            std::string body;
+            char size[16];
+            snprintf(size, sizeof(size), "%zx\r\n", half);
+            body += size + std::string(kManifest, half) + "\r\n";
+            snprintf(size, sizeof(size), "%zx\r\n", strlen(kManifest) - half);
+            body += size + std::string(kManifest + half) + "\r\n0\r\n\r\n";
+            int n = snprintf(header, sizeof(header),
+                             "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nETag: %s\r\nConnection: %s\r\n\r\n",
+                             kEtag, connection);
+            return sendAll(fd, header, n) && sendAll(fd, body.data(), body.size());
+        }
+
+        if (head.compare(0, 11, "GET /image ") != 0) {
+            int n = snprintf(header, sizeof(header),
+                             "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n", connection);
+            return sendAll(fd, header, n);
+        }
+
+        uint64_t start = 0, last = _imageBytes - 1;
+        unsigned long long a, b;
+        size_t range = head.find("Range: bytes=");
+        bool partial = range != std::string::npos && sscanf(head.c_str() + range, "Range: bytes=%llu-%llu", &a, &b) == 2;
+        if (partial) {
+            start = a;
+            last = std::min<uint64_t>(b, _imageBytes - 1);
+        }
+
+        int n = snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nContent-Length: %llu\r\nConnection: %s\r\n\r\n",
+                         partial ? "206 Partial Content" : "200 OK", (unsigned long long)(last - start + 1),
+                         connection);
+        if (!sendAll(fd, header, n)) return false;
+
+        uint8_t body[16384];
+        for (uint64_t offset = start; offset <= last;) {
+            size_t chunk = (size_t)std::min<uint64_t>(sizeof(body), last - offset + 1);
+            for (size_t i = 0; i < chunk; i++) body[i] = imageByte(offset + i);
+            if (!sendAll(fd, body, chunk)) return false;
+            offset += chunk;
+        }
+        return true;
+    }
+
+    static bool sendAll(int fd, const void* data, size_t length) {
+        const char* p = (const char*)data;
+        while (length > 0) {
+            ssize_t n = send(fd, p, length, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            p += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    size_t _imageBytes;
+    int _listen = -1;
+    uint16_t _port = 0;
+    std::atomic<int> _connections{0};
+};
+
+// ========================================
+// BENCHMARKS
+// ========================================
+
+static double seconds(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Full GET, read in readSize pieces and checked, like downloadAndFlash
+static bool downloadImage(const char* url, size_t imageBytes, size_t readSize, int receiveBuffer, double& secs) {
+    OtaSocketTransport transport(receiveBuffer);
+    transport.configure(NULL, 10000);
+
+    auto start = std::chrono::steady_clock::now();
+    if (transport.request("GET", url, NULL, 0, false) != 200 || transport.contentLength() != (int)imageBytes) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(readSize);
+    uint64_t offset = 0;
+    bool ok = true;
+    int n;
+    while ((n = transport.read(buffer.data(), buffer.size())) > 0) {
+        for (int i = 0; i < n; i++) ok = ok && buffer[i] == imageByte(offset + i);
+        offset += n;
+    }
+    transport.end();
+    secs = seconds(start);
+    return ok && n == 0 && offset == imageBytes;
+}
+
+// Small Range reads spread over the image, like the fleet manifest binary search
+static bool rangeLookups(const char* url, size_t imageBytes, int requests, bool keepAlive, double& secs) {
+    OtaSocketTransport transport;
+    transport.configure(NULL, 10000);
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (int i = 0; i < requests && ok; i++) {
+        uint64_t offset = (uint64_t)i * 7919 * 48 % (imageBytes - 48);
+        char range[48];
+        snprintf(range, sizeof(range), "bytes=%llu-%llu", (unsigned long long)offset,
+                 (unsigned long long)offset + 47);
+        OtaHeader_t headers[] = {{"Range", range}};
+
+        uint8_t record[48];
+        size_t got = 0;
+        ok = transport.request("GET", url, headers, 1, keepAlive) == 206;
+        while (ok && got < sizeof(record)) {
+            int n = transport.read(record + got, sizeof(record) - got);
+            ok = n > 0;
+            got += ok ? n : 0;
+        }
+        for (size_t j = 0; ok && j < sizeof(record); j++) ok = record[j] == imageByte(offset + j);
+        transport.end();
+    }
+    transport.stop();
+    secs = seconds(start);
+    return ok;
+}
+
+static bool chunkedManifest(const char* url) {
+    OtaSocketTransport transport;
+    transport.configure(NULL, 10000);
+    if (transport.request("GET", url, NULL, 0, false) != 200 || strcmp(transport.etag(), kEtag) != 0) {
+        return false;
+    }
+    std::string body;
+    uint8_t buffer[7];  // Odd size to cross chunk boundaries
+    int n;
+    while ((n = transport.read(buffer, sizeof(buffer))) > 0) body.append((const char*)buffer, n);
+    transport.end();
+    return n == 0 && body == kManifest && transport.contentLength() == -1;
+}
+
+static void usage() {
+    printf(
+        "Usage: transport_bench [options]\n"
+        "  --mb N         Image size in MB (default 64)\n"
+        "  --read N       Read size in bytes, repeatable (default 512 and 4096)\n"
+        "  --requests N   Range requests per keep-alive run (default 200)\n");
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    bool readGiven = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 || i + 1 >= argc) {
+            usage();
+            return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 2;
+        }
+        double v = atof(argv[++i]);
+        if (strcmp(argv[i - 1], "--mb") == 0) {
+            opt.imageBytes = (size_t)(v * 1024 * 1024);
+        } else if (strcmp(argv[i - 1], "--read") == 0) {
+            if (!readGiven) opt.reads.clear();
+            readGiven = true;
+            opt.reads.push_back((size_t)v);
+        } else if (strcmp(argv[i - 1], "--requests") == 0) {
+            opt.requests = (int)v;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (opt.imageBytes < 1024 || opt.requests <= 0) {
+        usage();
+        return 2;
+    }
+    for (size_t read : opt.reads) {
+        if (read == 0) {
+            usage();
+            return 2;
+        }
+    }
+
+    Server server(opt.imageBytes);
+    if (!server.start()) {
+        fprintf(stderr, "Cannot start local server\n");
+        return 1;
+    }
+    char imageUrl[64], manifestUrl[64];
+    snprintf(imageUrl, sizeof(imageUrl), "http://127.0.0.1:%u/image", server.port());
+    snprintf(manifestUrl, sizeof(manifestUrl), "http://127.0.0.1:%u/manifest", server.port());
+
+    bool allOk = true;
+    double mb = opt.imageBytes / 1048576.0;
+    printf("Full download, %.1f MB image\n", mb);
+    printf("%6s %8s %10s %9s  %s\n", "read", "rcvbuf", "MB/s", "ms/MB", "check");
+    const int receiveBuffers[] = {0, 256 * 1024};
+    for (size_t read : opt.reads) {
+        for (int receiveBuffer : receiveBuffers) {
+            double secs = 0;
+            bool ok = downloadImage(imageUrl, opt.imageBytes, read, receiveBuffer, secs);
+            char rcvbuf[16];
+            snprintf(rcvbuf, sizeof(rcvbuf), receiveBuffer ? "%dK" : "default", receiveBuffer / 1024);
+            printf("%6zu %8s %10.1f %9.3f  %s\n", read, rcvbuf, mb / secs, secs * 1000 / mb, ok ? "ok" : "FAIL");
+            allOk = allOk && ok;
+        }
+    }
+
+    printf("\nRange lookups, %d x 48 bytes\n", opt.requests);
+    printf("%-11s %12s %12s  %s\n", "connection", "us/request", "connections", "check");
+    for (bool keepAlive : {false, true}) {
+        int before = server.connections();
+        double secs = 0;
+        bool ok = rangeLookups(imageUrl, opt.imageBytes, opt.requests, keepAlive, secs);
+        printf("%-11s %12.1f %12d  %s\n", keepAlive ? "keep-alive" : "close", secs * 1e6 / opt.requests,
+               server.connections() - before, ok ? "ok" : "FAIL");
+        allOk = allOk && ok;
+    }
+
+    bool chunkedOk = chunkedManifest(manifestUrl);
+    printf("\nChunked manifest + ETag: %s\n", chunkedOk ? "ok" : "FAIL");
+    allOk = allOk && chunkedOk;
+
+    return allOk ? 0 : 1;
+}